@@ -0,0 +1,496 @@
+// ============================================================================
+// Hot path microbenchmarks
+// Builds main.c unchanged (its entry point renamed) and times the request
+// path functions in isolation. Compile with the server's flags:
+//
+//   cc -Os -static -nostdlib -fno-stack-protector -fno-asynchronous-unwind-tables
+//      -fomit-frame-pointer -fno-pic -no-pie -Wl,-e,_start -o bench/bench bench/bench.c
+//   ./bench/bench -baseline=bench/baseline.txt -threshold=25
+//
+// Flags:
+//   -baseline=FILE   name=ns_per_op lines (best round) to compare against,
+//                    plus the machine= line of the CPU that produced them
+//   -threshold=PCT   allowed slowdown before a result counts as a regression
+//   -rounds=N        timed rounds per benchmark (median is reported)
+//   -update=1        print results in baseline format instead of the table
+//   -check=1         exit with status 1 on a regression (reference machine)
+//
+// Regressions are flagged only against a baseline from the same machine,
+// and only fail the run with -check=1. The route table is the built-in one
+// whether or not assets.h exists, and the build flags should be the ones
+// above (no -D options) so the numbers stay comparable.
+// ============================================================================
+#define _start diggy_start
+#define DIGGY_BENCH  // Built-in routes only: results must not depend on assets/
+#include "../main.c"
+#undef _start
+
+#define MAX_ROUNDS 101
+#define ROUND_NS 2000000ul  // Target duration of one timed round
+
+// Keep the compiler from folding inputs or discarding results
+#define OPAQUE(x)   __asm__ volatile("" : "+r"(x))
+#define CLOBBER()   __asm__ volatile("" ::: "memory")
+
+static u64 sink;
+
+// ============================================================================
+// Representative inputs
+// ============================================================================
+static const char req_curl[] =
+  "GET /health HTTP/1.1\r\n"
+  "Host: localhost:8080\r\n"
+  "User-Agent: curl/8.5.0\r\n"
+  "Accept: */*\r\n"
+  "\r\n";
+static const char req_query[] =
+  "GET /about?utm_source=bench&ref=1 HTTP/1.1\r\n"
+  "Host: diggy\r\n"
+  "\r\n";
+static const char path_hit[] = "/info";
+static const char path_miss[] = "/favicon.ico";
+static const int itoa_inputs[8] = { 0, 7, 42, 404, 8080, 65535, 1800000, 2147483647 };
+static const char* const ip_inputs[4] = { "0.0.0.0", "127.0.0.1", "10.20.30.40", "192.168.100.200" };
+static char bench_buf[MAX_RESPONSE_SIZE];
+
+// ============================================================================
+// Benchmarks: each runs its operation `iters` times
+// ============================================================================
+static void bench_extract_path(u64 iters){
+  const char* req = req_curl;
+  const char* p;
+  int len;
+  u64 i;
+  for(i = 0; i < iters; i++){
+    OPAQUE(req);
+    sink += extract_path(req, sizeof(req_curl) - 1, &p, &len) + len;
+  }
+}
+
+static void bench_extract_path_query(u64 iters){
+  const char* req = req_query;
+  const char* p;
+  int len;
+  u64 i;
+  for(i = 0; i < iters; i++){
+    OPAQUE(req);
+    sink += extract_path(req, sizeof(req_query) - 1, &p, &len) + len;
+  }
+}
+
+static void bench_find_route_hit(u64 iters){
+  const char* path = path_hit;
+  u64 i;
+  for(i = 0; i < iters; i++){
+    OPAQUE(path);
+    sink += (u64)find_route(path, sizeof(path_hit) - 1);
+  }
+}
+
+static void bench_find_route_miss(u64 iters){
+  const char* path = path_miss;
+  u64 i;
+  for(i = 0; i < iters; i++){
+    OPAQUE(path);
+    sink += (u64)find_route(path, sizeof(path_miss) - 1);
+  }
+}
+
+static void bench_build_response_small(u64 iters){
+  const Route* route = find_route("/health", 7);
+  u64 i;
+  for(i = 0; i < iters; i++){
+    OPAQUE(route);
+    sink += build_response(route, bench_buf, sizeof(bench_buf));
+    CLOBBER();
+  }
+}
+
+static void bench_build_response_lyrics(u64 iters){
+  const Route* route = find_route("/", 1);
+  u64 i;
+  for(i = 0; i < iters; i++){
+    OPAQUE(route);
+    sink += build_response(route, bench_buf, sizeof(bench_buf));
+    CLOBBER();
+  }
+}
+
+static void bench_build_404_response(u64 iters){
+  u64 i;
+  for(i = 0; i < iters; i++){
+    sink += build_404_response(bench_buf, sizeof(bench_buf));
+    CLOBBER();
+  }
+}
+
+static void bench_itoa(u64 iters){
+  char buf[12];
+  u64 i;
+  for(i = 0; i < iters; i++){
+    int v = itoa_inputs[i & 7];
+    OPAQUE(v);
+    sink += itoa(v, buf);
+    CLOBBER();
+  }
+}
+
+static void bench_parse_ip(u64 iters){
+  u64 i;
+  for(i = 0; i < iters; i++){
+    const char* ip = ip_inputs[i & 3];
+    OPAQUE(ip);
+    sink += parse_ip(ip, str_len(ip));
+  }
+}
+
+typedef struct {
+  const char* name;
+  void (*fn)(u64 iters);
+} Bench;
+
+static const Bench benches[] = {
+  {"extract_path",           bench_extract_path},
+  {"extract_path_query",     bench_extract_path_query},
+  {"find_route_hit",         bench_find_route_hit},
+  {"find_route_miss",        bench_find_route_miss},
+  {"build_response_small",   bench_build_response_small},
+  {"build_response_lyrics",  bench_build_response_lyrics},
+  {"build_404_response",     bench_build_404_response},
+  {"itoa",                   bench_itoa},
+  {"parse_ip",               bench_parse_ip},
+};
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+// ============================================================================
+// Output helpers
+// ============================================================================
+static void out(const char* s, int len){
+  sys(SYS_write, 1, (i64)s, len, 0, 0, 0);
+}
+
+static void out_str(const char* s){
+  out(s, str_len(s));
+}
+
+// Print a value held in hundredths as "123.45", right-aligned to width
+static void out_fixed2(u64 hundredths, int width){
+  char buf[32];
+  int n = u64toa(hundredths / 100, buf);
+  buf[n++] = '.';
+  buf[n++] = '0' + (hundredths / 10) % 10;
+  buf[n++] = '0' + hundredths % 10;
+  while(width-- > n) out(" ", 1);
+  out(buf, n);
+}
+
+static void out_padded(const char* s, int width){
+  int len = str_len(s);
+  out(s, len);
+  while(width-- > len) out(" ", 1);
+}
+
+// Parse "123.45" into hundredths
+static u64 parse_fixed2(const char* s, int len){
+  u64 whole = 0, frac = 0;
+  int i = 0, digits = 0;
+  while(i < len && s[i] >= '0' && s[i] <= '9') whole = whole * 10 + (s[i++] - '0');
+  if(i < len && s[i] == '.'){
+    i++;
+    while(i < len && digits < 2 && s[i] >= '0' && s[i] <= '9'){
+      frac = frac * 10 + (s[i++] - '0');
+      digits++;
+    }
+  }
+  while(digits++ < 2) frac *= 10;
+  return whole * 100 + frac;
+}
+
+// ============================================================================
+// Machine identity: CPU model and cache size, the hash of its feature flags
+// and the number of usable CPUs, so two hosts that report the same generic
+// model string still differ
+// ============================================================================
+static char cpuinfo_buf[8192];
+static char machine_buf[256];
+
+// First "<key><spaces>: value" line; returns the value length, -1 if absent
+static int cpuinfo_value(int n, const char* key, const char** value){
+  int key_len = str_len(key);
+  int line_start = 0;
+  int i;
+  for(i = 0; i < n; i++){
+    if(cpuinfo_buf[i] != '\n') continue;
+    if(i - line_start > key_len && str_equals(cpuinfo_buf + line_start, key, key_len) &&
+       (cpuinfo_buf[line_start + key_len] == '\t' || cpuinfo_buf[line_start + key_len] == ' ' ||
+        cpuinfo_buf[line_start + key_len] == ':')){
+      int v = line_start + key_len;
+      while(v < i && (cpuinfo_buf[v] == '\t' || cpuinfo_buf[v] == ' ' || cpuinfo_buf[v] == ':')) v++;
+      *value = cpuinfo_buf + v;
+      return i - v;
+    }
+    line_start = i + 1;
+  }
+  return -1;
+}
+
+static int machine_append(int pos, const char* s, int len){
+  if(len < 0) return pos;
+  if(pos + len > (int)sizeof(machine_buf)) len = sizeof(machine_buf) - pos;
+  memcpy_manual(machine_buf + pos, s, len);
+  return pos + len;
+}
+
+static int machine_id(const char** id){
+  static const char hex[] = "0123456789abcdef";
+  const char* v;
+  int fd, n, len, i, pos = 0;
+  u64 mask[16] = {0};
+  u64 h = 0xcbf29ce484222325ul;
+  char num[24];
+
+#if defined(__x86_64__)
+  fd = (int)sys(SYS_open, (i64)"/proc/cpuinfo", O_RDONLY, 0, 0, 0, 0);
+#elif defined(__aarch64__)
+  fd = (int)sys(SYS_openat, AT_FDCWD, (i64)"/proc/cpuinfo", O_RDONLY, 0, 0, 0);
+#endif
+  n = fd < 0 ? 0 : (int)sys(SYS_read, fd, (i64)cpuinfo_buf, sizeof(cpuinfo_buf), 0, 0, 0);
+  if(fd >= 0) sys(SYS_close, fd, 0, 0, 0, 0, 0);
+  if(n < 0) n = 0;
+
+  // x86: model name, cache size, flags; arm: CPU implementer/part, Features
+  len = cpuinfo_value(n, "model name", &v);
+  if(len < 0){
+    pos = machine_append(pos, "impl ", 5);
+    pos = machine_append(pos, v, cpuinfo_value(n, "CPU implementer", &v));
+    pos = machine_append(pos, " part ", 6);
+    len = cpuinfo_value(n, "CPU part", &v);
+  }
+  pos = machine_append(pos, v, len);
+  len = cpuinfo_value(n, "cache size", &v);
+  if(len > 0){
+    pos = machine_append(pos, "; cache ", 8);
+    pos = machine_append(pos, v, len);
+  }
+
+  len = cpuinfo_value(n, "flags", &v);
+  if(len < 0) len = cpuinfo_value(n, "Features", &v);
+  for(i = 0; i < len; i++){
+    h ^= (unsigned char)v[i];
+    h *= 0x100000001b3ul;
+  }
+  pos = machine_append(pos, "; flags ", 8);
+  for(i = 0; i < 8; i++) num[i] = hex[(h >> (60 - 4 * i)) & 0xf];
+  pos = machine_append(pos, num, 8);
+
+  len = 0;
+  if(sys(SYS_sched_getaffinity, 0, sizeof(mask), (i64)mask, 0, 0, 0) > 0){
+    for(i = 0; i < 16 * 64; i++) len += (mask[i / 64] >> (i % 64)) & 1;
+  }
+  pos = machine_append(pos, "; cpus ", 7);
+  pos = machine_append(pos, num, itoa(len, num));
+
+  *id = machine_buf;
+  return pos;
+}
+
+// ============================================================================
+// Baseline file: machine=<cpu>, then name=ns_per_op, one per line
+// ============================================================================
+static char baseline_buf[4096];
+static int baseline_len;
+
+static int load_baseline(const char* filename){
+  int fd;
+#if defined(__x86_64__)
+  fd = (int)sys(SYS_open, (i64)filename, O_RDONLY, 0, 0, 0, 0);
+#elif defined(__aarch64__)
+  fd = (int)sys(SYS_openat, AT_FDCWD, (i64)filename, O_RDONLY, 0, 0, 0);
+#endif
+  if(fd < 0) return 0;
+  baseline_len = (int)sys(SYS_read, fd, (i64)baseline_buf, sizeof(baseline_buf), 0, 0, 0);
+  sys(SYS_close, fd, 0, 0, 0, 0, 0);
+  if(baseline_len < 0) baseline_len = 0;
+  return baseline_len > 0;
+}
+
+// Finds "name=value"; returns the value length, -1 if absent
+static int baseline_value(const char* name, const char** value){
+  int name_len = str_len(name);
+  int line_start = 0;
+  int i;
+  for(i = 0; i <= baseline_len; i++){
+    if(i == baseline_len || baseline_buf[i] == '\n'){
+      const char* line = baseline_buf + line_start;
+      int len = i - line_start;
+      if(len > name_len && line[name_len] == '=' && str_equals(line, name, name_len)){
+        *value = line + name_len + 1;
+        return len - name_len - 1;
+      }
+      line_start = i + 1;
+    }
+  }
+  return -1;
+}
+
+// Returns the baseline in hundredths of ns/op, 0 if absent
+static u64 baseline_for(const char* name){
+  const char* v;
+  int len = baseline_value(name, &v);
+  return len > 0 ? parse_fixed2(v, len) : 0;
+}
+
+// Whether the baseline was recorded on this CPU
+static int baseline_matches_machine(const char* id, int id_len){
+  const char* v;
+  int len = baseline_value("machine", &v);
+  return len == id_len && id_len > 0 && str_equals(v, id, len);
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+static void sort_u64(u64* v, int n){
+  int i, j;
+  for(i = 1; i < n; i++){
+    u64 x = v[i];
+    for(j = i; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+    v[j] = x;
+  }
+}
+
+typedef struct {
+  u64 ns_min;       // Hundredths of ns/op
+  u64 ns_median;
+  u64 cycles_median;  // Hundredths of counter ticks/op
+} Result;
+
+static Result run_bench(const Bench* b, int rounds){
+  static u64 ns[MAX_ROUNDS];
+  static u64 cyc[MAX_ROUNDS];
+  Result r;
+  u64 iters = 1;
+  int i;
+
+  // Warmup: grow the batch until one round takes ROUND_NS
+  for(;;){
+    u64 t0 = monotonic_ns();
+    b->fn(iters);
+    if(monotonic_ns() - t0 >= ROUND_NS || iters >= (1ul << 40)) break;
+    iters *= 2;
+  }
+  b->fn(iters);
+
+  for(i = 0; i < rounds; i++){
+    u64 t0 = monotonic_ns();
+    u64 c0 = rdcycles();
+    b->fn(iters);
+    u64 c1 = rdcycles();
+    u64 t1 = monotonic_ns();
+    ns[i] = (t1 - t0) * 100 / iters;
+    cyc[i] = (c1 - c0) * 100 / iters;
+  }
+  sort_u64(ns, rounds);
+  sort_u64(cyc, rounds);
+  r.ns_min = ns[0];
+  r.ns_median = ns[rounds / 2];
+  r.cycles_median = cyc[rounds / 2];
+  return r;
+}
+
+void _start(void){
+  char args[2048];
+  const char* baseline_file = "bench/baseline.txt";
+  int threshold = 25;
+  int rounds = 51;
+  int update = 0;
+  int check_exit = 0;
+  int fd, n, pos = 0;
+
+#if defined(__x86_64__)
+  fd = (int)sys(SYS_open, (i64)"/proc/self/cmdline", O_RDONLY, 0, 0, 0, 0);
+#elif defined(__aarch64__)
+  fd = (int)sys(SYS_openat, AT_FDCWD, (i64)"/proc/self/cmdline", O_RDONLY, 0, 0, 0);
+#endif
+  n = fd < 0 ? 0 : (int)sys(SYS_read, fd, (i64)args, sizeof(args) - 1, 0, 0, 0);
+  if(fd >= 0) sys(SYS_close, fd, 0, 0, 0, 0, 0);
+  if(n < 0) n = 0;
+  args[n] = '\0';
+
+  // skip argv[0]
+  while(pos < n && args[pos] != '\0') pos++;
+  pos++;
+  while(pos < n){
+    const char* a = args + pos;
+    int len = str_len(a);
+    while(len > 0 && *a == '-'){ a++; len--; }
+    if(len > 9 && str_equals(a, "baseline=", 9)) baseline_file = a + 9;
+    else if(len > 10 && str_equals(a, "threshold=", 10)) threshold = str_to_int(a + 10, len - 10);
+    else if(len > 7 && str_equals(a, "rounds=", 7)) rounds = str_to_int(a + 7, len - 7);
+    else if(len > 7 && str_equals(a, "update=", 7)) update = str_to_int(a + 7, len - 7);
+    else if(len > 6 && str_equals(a, "check=", 6)) check_exit = str_to_int(a + 6, len - 6);
+    pos += str_len(args + pos) + 1;
+  }
+  if(rounds < 1) rounds = 1;
+  if(rounds > MAX_ROUNDS) rounds = MAX_ROUNDS;
+
+  init_routes();
+  const char* machine = "";
+  int machine_len = machine_id(&machine);
+  int have_baseline = !update && load_baseline(baseline_file);
+  int check = have_baseline && baseline_matches_machine(machine, machine_len);
+  int regressions = 0;
+  int i;
+
+  if(update){
+    out_str("machine=");
+    out(machine, machine_len);
+    out("\n", 1);
+  } else if(have_baseline && !check){
+    out_str("baseline was recorded on another machine; not checking (refresh with -update=1)\n");
+  }
+  if(!update){
+    out_str("benchmark                  ns/op(med)  ns/op(min)  cyc/op(med)    baseline\n");
+  }
+
+  for(i = 0; i < NUM_BENCHES; i++){
+    Result r = run_bench(&benches[i], rounds);
+
+    if(update){
+      out_str(benches[i].name);
+      out("=", 1);
+      out_fixed2(r.ns_min, 0);
+      out("\n", 1);
+      continue;
+    }
+
+    out_padded(benches[i].name, 24);
+    out_fixed2(r.ns_median, 12);
+    out_fixed2(r.ns_min, 12);
+    out_fixed2(r.cycles_median, 13);
+
+    u64 base = have_baseline ? baseline_for(benches[i].name) : 0;
+    if(base){
+      out_fixed2(base, 12);
+      // Compare the best round so scheduler noise does not flag regressions
+      if(check && r.ns_min * 100 > base * (u64)(100 + threshold)){
+        out_str("  REGRESSION");
+        regressions++;
+      }
+    }
+    out("\n", 1);
+  }
+
+  if(check){
+    char num[12];
+    out_str(!regressions ? "OK: " : check_exit ? "FAIL: " : "WARN: ");
+    out(num, itoa(regressions, num));
+    out_str(" regression(s) beyond ");
+    out(num, itoa(threshold, num));
+    out_str("% of baseline");
+    out_str(regressions && !check_exit ? " (report only, -check=1 to fail)\n" : "\n");
+  }
+
+  sys(SYS_exit, regressions && check_exit ? 1 : 0, 0, 0, 0, 0, 0);
+  for(;;){}
+}
@@ -0,0 +1,1066 @@
+#pragma once
+
+// ============================================================================
+// HTTP/2 cleartext (h2c)
+// Entered by prior knowledge (the request starts with the client preface) or
+// by "Upgrade: h2c" on an HTTP/1.1 request. h2 connections stay open, are
+// polled by the main loop and serve any number of concurrent streams from
+// the static route table. Response headers are precomputed per route using
+// only the HPACK static table; request headers are fully decoded (Huffman
+// and dynamic table) so the decoder stays in sync with the client.
+// ============================================================================
+#define H2_MAX_CONNS 128
+#define H2_MAX_STREAMS 128      // Also advertised as SETTINGS_MAX_CONCURRENT_STREAMS
+#define H2_MAX_FRAME 16384      // SETTINGS_MAX_FRAME_SIZE, never raised
+#define H2_IN_BUF (H2_MAX_FRAME + 9 + 4096)
+#define H2_OUT_BUF 32768
+#define H2_OUT_RESERVE 1024     // Room kept for control frames and HEADERS
+#define H2_BLOCK_BUF 16384      // One header block including CONTINUATIONs
+#define H2_TABLE_SIZE 4096      // HPACK dynamic table, SETTINGS_HEADER_TABLE_SIZE default
+#define H2_ROUTE_BLOCK 256      // Precomputed response header block
+#define H2_WINDOW_MAX 0x7fffffff
+#define H2_IDLE_NS (30 * 1000000000ul)  // No bytes in or out for this long: close
+
+// Frame types
+#define H2_DATA 0x0
+#define H2_HEADERS 0x1
+#define H2_PRIORITY 0x2
+#define H2_RST_STREAM 0x3
+#define H2_SETTINGS 0x4
+#define H2_PUSH_PROMISE 0x5
+#define H2_PING 0x6
+#define H2_GOAWAY 0x7
+#define H2_WINDOW_UPDATE 0x8
+#define H2_CONTINUATION 0x9
+
+// Frame flags
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+#define H2_FLAG_PRIORITY 0x20
+
+// Error codes
+#define H2_NO_ERROR 0x0
+#define H2_PROTOCOL_ERROR 0x1
+#define H2_FLOW_CONTROL_ERROR 0x3
+#define H2_FRAME_SIZE_ERROR 0x6
+#define H2_REFUSED_STREAM 0x7
+#define H2_COMPRESSION_ERROR 0x9
+
+// Settings
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define H2_SETTINGS_MAX_FRAME_SIZE 0x5
+
+static const char h2_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+#define H2_PREFACE_LEN (sizeof(h2_preface) - 1)
+
+typedef struct {
+  u32 id;
+  const char* data;  // Body still to send
+  int remaining;
+  i64 window;        // Peer's stream window
+} H2Stream;
+
+typedef struct {
+  int used;
+  int fd;
+  int preface_seen;     // Bytes of the client preface received so far
+  int closing;          // GOAWAY sent or received: flush, then close
+  int eof;              // Peer shut down its side: nothing more to read
+  u64 last_active_ns;   // Last successful read or write
+  u32 last_stream;
+  u32 block_stream;     // Stream awaiting CONTINUATION, 0 if none
+  int block_is_request; // That block opens a new stream (not trailers)
+  i64 send_window;      // Peer's connection window
+  i64 peer_initial_window;
+  int peer_max_frame;
+  u64 recv_unacked;     // DATA bytes not yet returned with WINDOW_UPDATE
+  int num_streams;
+  int in_len;
+  int out_len;
+  int block_len;
+  int table_len;        // Bytes used in table[]
+  int table_size;       // HPACK size: name + value + 32 per entry
+  int table_max;
+  H2Stream streams[H2_MAX_STREAMS];
+  // Dynamic table, newest entry first: [name_len:2][value_len:2][name][value]
+  unsigned char table[H2_TABLE_SIZE];
+  char block[H2_BLOCK_BUF];
+  char in[H2_IN_BUF];
+  char out[H2_OUT_BUF];
+} H2Conn;
+
+static H2Conn* h2_conns;  // H2_MAX_CONNS entries, mapped lazily by main.c
+static int h2_active;
+
+// Precomputed response header blocks, indexed like routes[]
+static char h2_route_blocks[NUM_ROUTES][H2_ROUTE_BLOCK];
+static int h2_route_block_len[NUM_ROUTES];
+static char h2_404_block[H2_ROUTE_BLOCK];
+static int h2_404_block_len;
+
+// ============================================================================
+// HPACK tables (RFC 7541 appendices A and B)
+// Huffman codes are canonical: symbols are listed in code order, and codes of
+// each length form a contiguous range starting at h2_huff_first[length].
+// ============================================================================
+static const char* const h2_static_table[61][2] = {
+  {":authority", ""},
+  {":method", "GET"},
+  {":method", "POST"},
+  {":path", "/"},
+  {":path", "/index.html"},
+  {":scheme", "http"},
+  {":scheme", "https"},
+  {":status", "200"},
+  {":status", "204"},
+  {":status", "206"},
+  {":status", "304"},
+  {":status", "400"},
+  {":status", "404"},
+  {":status", "500"},
+  {"accept-charset", ""},
+  {"accept-encoding", "gzip, deflate"},
+  {"accept-language", ""},
+  {"accept-ranges", ""},
+  {"accept", ""},
+  {"access-control-allow-origin", ""},
+  {"age", ""},
+  {"allow", ""},
+  {"authorization", ""},
+  {"cache-control", ""},
+  {"content-disposition", ""},
+  {"content-encoding", ""},
+  {"content-language", ""},
+  {"content-length", ""},
+  {"content-location", ""},
+  {"content-range", ""},
+  {"content-type", ""},
+  {"cookie", ""},
+  {"date", ""},
+  {"etag", ""},
+  {"expect", ""},
+  {"expires", ""},
+  {"from", ""},
+  {"host", ""},
+  {"if-match", ""},
+  {"if-modified-since", ""},
+  {"if-none-match", ""},
+  {"if-range", ""},
+  {"if-unmodified-since", ""},
+  {"last-modified", ""},
+  {"link", ""},
+  {"location", ""},
+  {"max-forwards", ""},
+  {"proxy-authenticate", ""},
+  {"proxy-authorization", ""},
+  {"range", ""},
+  {"referer", ""},
+  {"refresh", ""},
+  {"retry-after", ""},
+  {"server", ""},
+  {"set-cookie", ""},
+  {"strict-transport-security", ""},
+  {"transfer-encoding", ""},
+  {"user-agent", ""},
+  {"vary", ""},
+  {"via", ""},
+  {"www-authenticate", ""},
+};
+
+static const unsigned char h2_huff_syms[256] = {
+  48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51,
+  52, 53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109,
+  110, 112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+  77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118,
+  119, 120, 121, 122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39,
+  43, 124, 35, 62, 0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+  195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+  179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+  163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+  233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+  158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+  144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+  200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+  212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+  2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+  21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22,
+};
+static const u32 h2_huff_first[31] = {
+  0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x14, 0x5c,
+  0xf8, 0x0, 0x3f8, 0x7fa, 0xffa, 0x1ff8, 0x3ffc, 0x7ffc,
+  0x0, 0x0, 0x0, 0x7fff0, 0xfffe6, 0x1fffdc, 0x3fffd2, 0x7fffd8,
+  0xffffea, 0x1ffffec, 0x3ffffe0, 0x7ffffde, 0xfffffe2, 0x0, 0x3ffffffc,
+};
+static const unsigned char h2_huff_count[31] = {
+  0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3, 0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 3,
+};
+static const unsigned char h2_huff_index[31] = {
+  0, 0, 0, 0, 0, 0, 10, 36, 68, 0, 74, 79, 82, 84, 90, 92, 0, 0, 0, 95, 98, 106, 119, 145, 174, 186, 190, 205, 224, 0, 253,
+};
+
+// ============================================================================
+// Byte helpers
+// ============================================================================
+static u32 h2_get32(const char* p){
+  const unsigned char* u = (const unsigned char*)p;
+  return ((u32)u[0] << 24) | ((u32)u[1] << 16) | ((u32)u[2] << 8) | u[3];
+}
+
+static void h2_put32(char* p, u32 v){
+  p[0] = (char)(v >> 24);
+  p[1] = (char)(v >> 16);
+  p[2] = (char)(v >> 8);
+  p[3] = (char)v;
+}
+
+// ============================================================================
+// HPACK encoder: literal header fields without indexing, static table names
+// ============================================================================
+static int hpack_put_int(char* out, u32 v, int prefix_bits, unsigned char flags){
+  u32 max = (1u << prefix_bits) - 1;
+  int n = 0;
+  if(v < max){
+    out[n++] = (char)(flags | v);
+    return n;
+  }
+  out[n++] = (char)(flags | max);
+  v -= max;
+  while(v >= 128){
+    out[n++] = (char)(0x80 | (v & 0x7f));
+    v >>= 7;
+  }
+  out[n++] = (char)v;
+  return n;
+}
+
+static int hpack_put_literal(char* out, int name_index, const char* value, int value_len){
+  int n = hpack_put_int(out, name_index, 4, 0x00);
+  n += hpack_put_int(out + n, value_len, 7, 0x00);
+  memcpy_manual(out + n, value, value_len);
+  return n + value_len;
+}
+
+// :status (static index), content-type (31), content-length (28), etag (34)
+static int h2_build_block(char* out, int status_index, const char* type, int type_len,
+                          int content_len, const char* etag, int etag_len){
+  char len_str[12];
+  int len_digits = itoa(content_len, len_str);
+  int n = 0;
+
+  // Worst case: 1 + 2 * (2 + 3 + value) bytes plus the etag field
+  if(type_len + etag_len + len_digits + 32 > H2_ROUTE_BLOCK) type_len = etag_len = 0;
+
+  n += hpack_put_int(out, status_index, 7, 0x80);
+  if(type_len) n += hpack_put_literal(out + n, 31, type, type_len);
+  n += hpack_put_literal(out + n, 28, len_str, len_digits);
+  if(etag_len) n += hpack_put_literal(out + n, 34, etag, etag_len);
+  return n;
+}
+
+static void h2_init(void){
+  static const char not_found_type[] = "text/plain";
+  int i;
+  for(i = 0; i < NUM_ROUTES; i++){
+    const Route* r = &routes[i];
+    if(r->handler) continue;  // Dynamic routes are HTTP/1 only
+    h2_route_block_len[i] = h2_build_block(h2_route_blocks[i], 8, r->content_type,
+                                           r->content_type_len, r->content_len,
+                                           r->etag, r->etag_len);
+  }
+  h2_404_block_len = h2_build_block(h2_404_block, 13, not_found_type,
+                                    sizeof(not_found_type) - 1, 9, 0, 0);
+}
+
+// ============================================================================
+// HPACK decoder
+// ============================================================================
+#define H2_SCRATCH_SIZE (2 * H2_BLOCK_BUF)
+static char* h2_scratch;  // Strings decoded from one block, in the hot region
+static int h2_scratch_len;
+
+// Returns the integer, or -1 on malformed/overflowing input
+static i64 hpack_get_int(const unsigned char* p, int len, int* pos, int prefix_bits){
+  u32 max = (1u << prefix_bits) - 1;
+  i64 v;
+  int shift = 0;
+
+  if(*pos >= len) return -1;
+  v = p[(*pos)++] & max;
+  if(v < max) return v;
+  for(;;){
+    if(*pos >= len || shift > 28) return -1;
+    unsigned char b = p[(*pos)++];
+    v += (i64)(b & 0x7f) << shift;
+    shift += 7;
+    if(!(b & 0x80)) break;
+  }
+  return v > H2_WINDOW_MAX ? -1 : v;
+}
+
+// Copy into scratch so the bytes outlive dynamic table changes
+static const char* h2_scratch_copy(const char* s, int len){
+  char* dst = h2_scratch + h2_scratch_len;
+  if(len > H2_SCRATCH_SIZE - h2_scratch_len) return 0;
+  memcpy_manual(dst, s, len);
+  h2_scratch_len += len;
+  return dst;
+}
+
+// Decode a string literal (raw or Huffman) into scratch
+static int hpack_get_str(const unsigned char* p, int len, int* pos, const char** out, int* out_len){
+  if(*pos >= len) return 0;
+  int huffman = p[*pos] & 0x80;
+  i64 n = hpack_get_int(p, len, pos, 7);
+  if(n < 0 || n > len - *pos) return 0;
+  const unsigned char* s = p + *pos;
+  *pos += (int)n;
+
+  if(!huffman){
+    *out = h2_scratch_copy((const char*)s, (int)n);
+    *out_len = (int)n;
+    return *out != 0;
+  }
+
+  char* dst = h2_scratch + h2_scratch_len;
+  int cap = H2_SCRATCH_SIZE - h2_scratch_len;
+  int dn = 0;
+  u32 code = 0;
+  int bits = 0;
+  int i, b;
+  for(i = 0; i < n; i++){
+    for(b = 7; b >= 0; b--){
+      code = (code << 1) | ((s[i] >> b) & 1);
+      bits++;
+      if(code - h2_huff_first[bits] < h2_huff_count[bits]){
+        if(dn == cap) return 0;
+        dst[dn++] = (char)h2_huff_syms[h2_huff_index[bits] + code - h2_huff_first[bits]];
+        code = 0;
+        bits = 0;
+      } else if(bits == 30){
+        return 0;  // EOS or invalid code
+      }
+    }
+  }
+  // Padding must be a prefix of EOS (all ones) shorter than 8 bits
+  if(bits > 7 || code != (1u << bits) - 1) return 0;
+
+  h2_scratch_len += dn;
+  *out = dst;
+  *out_len = dn;
+  return 1;
+}
+
+static int hpack_entry_bytes(const unsigned char* e){
+  return 4 + ((e[0] << 8) | e[1]) + ((e[2] << 8) | e[3]);
+}
+
+// Look up a 1-based index across the static and dynamic tables
+static int hpack_lookup(H2Conn* c, i64 index, const char** name, int* name_len,
+                        const char** value, int* value_len){
+  if(index <= 0) return 0;
+  if(index <= 61){
+    *name = h2_static_table[index - 1][0];
+    *name_len = str_len(*name);
+    *value = h2_static_table[index - 1][1];
+    *value_len = str_len(*value);
+    return 1;
+  }
+  index -= 62;
+  int off = 0;
+  while(off < c->table_len){
+    const unsigned char* e = c->table + off;
+    if(index-- == 0){
+      *name_len = (e[0] << 8) | e[1];
+      *value_len = (e[2] << 8) | e[3];
+      *name = (const char*)e + 4;
+      *value = *name + *name_len;
+      return 1;
+    }
+    off += hpack_entry_bytes(e);
+  }
+  return 0;
+}
+
+// Evict oldest entries until the table fits in max
+static void hpack_evict(H2Conn* c, int max){
+  while(c->table_size > max){
+    int off = 0, last = 0;
+    while(off < c->table_len){
+      last = off;
+      off += hpack_entry_bytes(c->table + off);
+    }
+    c->table_size -= hpack_entry_bytes(c->table + last) - 4 + 32;
+    c->table_len = last;
+  }
+}
+
+static void hpack_insert(H2Conn* c, const char* name, int name_len, const char* value, int value_len){
+  int size = name_len + value_len + 32;
+  int bytes = 4 + name_len + value_len;
+  int i;
+
+  if(size > c->table_max){
+    hpack_evict(c, 0);
+    return;
+  }
+  hpack_evict(c, c->table_max - size);
+
+  // Shift existing entries back; they always fit since each costs 32 in size
+  for(i = c->table_len - 1; i >= 0; i--) c->table[i + bytes] = c->table[i];
+  c->table[0] = (unsigned char)(name_len >> 8);
+  c->table[1] = (unsigned char)name_len;
+  c->table[2] = (unsigned char)(value_len >> 8);
+  c->table[3] = (unsigned char)value_len;
+  memcpy_manual((char*)c->table + 4, name, name_len);
+  memcpy_manual((char*)c->table + 4 + name_len, value, value_len);
+  c->table_len += bytes;
+  c->table_size += size;
+}
+
+// Decode a header block, picking out :path and :method
+static int hpack_decode(H2Conn* c, const char* block, int len,
+                        const char** path, int* path_len, int* head){
+  const unsigned char* p = (const unsigned char*)block;
+  int pos = 0;
+
+  h2_scratch_len = 0;
+  *path = 0;
+  *path_len = 0;
+  *head = 0;
+
+  while(pos < len){
+    unsigned char b = p[pos];
+    const char* name;
+    const char* value;
+    int name_len, value_len;
+
+    if(b & 0x80){
+      // Indexed header field
+      i64 index = hpack_get_int(p, len, &pos, 7);
+      if(!hpack_lookup(c, index, &name, &name_len, &value, &value_len)) return 0;
+    } else if((b & 0xe0) == 0x20){
+      // Dynamic table size update
+      i64 max = hpack_get_int(p, len, &pos, 5);
+      if(max < 0 || max > H2_TABLE_SIZE) return 0;
+      c->table_max = (int)max;
+      hpack_evict(c, c->table_max);
+      continue;
+    } else {
+      // Literal: with incremental indexing (01), without (0000) or never (0001)
+      int indexing = b & 0x40;
+      i64 index = hpack_get_int(p, len, &pos, indexing ? 6 : 4);
+      if(index < 0) return 0;
+      if(index > 0){
+        const char* unused;
+        int unused_len;
+        if(!hpack_lookup(c, index, &name, &name_len, &unused, &unused_len)) return 0;
+        if(!(name = h2_scratch_copy(name, name_len))) return 0;
+      } else if(!hpack_get_str(p, len, &pos, &name, &name_len)){
+        return 0;
+      }
+      if(!hpack_get_str(p, len, &pos, &value, &value_len)) return 0;
+      if(indexing) hpack_insert(c, name, name_len, value, value_len);
+    }
+
+    if(name_len == 5 && compare_strings(name, ":path", 5)){
+      if(!(*path = h2_scratch_copy(value, value_len))) return 0;
+      *path_len = value_len;
+    } else if(name_len == 7 && compare_strings(name, ":method", 7)){
+      *head = value_len == 4 && compare_strings(value, "HEAD", 4);
+    }
+  }
+  return 1;
+}
+
+// ============================================================================
+// Frames and streams
+// ============================================================================
+static void h2_frame(H2Conn* c, int type, int flags, u32 stream, const char* payload, int len){
+  char* p;
+  if(c->out_len + 9 + len > H2_OUT_BUF){
+    c->closing = 1;  // Callers keep H2_OUT_RESERVE free, so this is a bug guard
+    return;
+  }
+  p = c->out + c->out_len;
+  p[0] = (char)(len >> 16);
+  p[1] = (char)(len >> 8);
+  p[2] = (char)len;
+  p[3] = (char)type;
+  p[4] = (char)flags;
+  h2_put32(p + 5, stream);
+  memcpy_manual(p + 9, payload, len);
+  c->out_len += 9 + len;
+}
+
+static void h2_goaway(H2Conn* c, u32 error){
+  char p[8];
+  h2_put32(p, c->last_stream);
+  h2_put32(p + 4, error);
+  h2_frame(c, H2_GOAWAY, 0, 0, p, 8);
+  c->closing = 1;
+  if(error != H2_NO_ERROR) c->num_streams = 0;
+}
+
+static void h2_rst_stream(H2Conn* c, u32 stream, u32 error){
+  char p[4];
+  h2_put32(p, error);
+  h2_frame(c, H2_RST_STREAM, 0, stream, p, 4);
+}
+
+static void h2_window_update(H2Conn* c, u32 stream, u32 increment){
+  char p[4];
+  h2_put32(p, increment);
+  h2_frame(c, H2_WINDOW_UPDATE, 0, stream, p, 4);
+}
+
+// Our SETTINGS, then open the connection window all the way
+static void h2_server_preface(H2Conn* c){
+  char p[12];
+  p[0] = 0; p[1] = H2_SETTINGS_MAX_CONCURRENT_STREAMS;
+  h2_put32(p + 2, H2_MAX_STREAMS);
+  p[6] = 0; p[7] = H2_SETTINGS_INITIAL_WINDOW_SIZE;
+  h2_put32(p + 8, H2_WINDOW_MAX);
+  h2_frame(c, H2_SETTINGS, 0, 0, p, sizeof(p));
+  h2_window_update(c, 0, H2_WINDOW_MAX - 65535);
+}
+
+// Validate a SETTINGS payload without applying anything
+static int h2_check_settings(const char* p, int len){
+  int i;
+  for(i = 0; i + 6 <= len; i += 6){
+    int id = ((unsigned char)p[i] << 8) | (unsigned char)p[i + 1];
+    u32 v = h2_get32(p + i + 2);
+    if(id == H2_SETTINGS_INITIAL_WINDOW_SIZE && v > H2_WINDOW_MAX) return H2_FLOW_CONTROL_ERROR;
+    if(id == H2_SETTINGS_MAX_FRAME_SIZE && (v < 16384 || v > 16777215)) return H2_PROTOCOL_ERROR;
+  }
+  return H2_NO_ERROR;
+}
+
+static int h2_apply_settings(H2Conn* c, const char* p, int len){
+  int err = h2_check_settings(p, len);
+  int i;
+  if(err) return err;
+  for(i = 0; i + 6 <= len; i += 6){
+    int id = ((unsigned char)p[i] << 8) | (unsigned char)p[i + 1];
+    u32 v = h2_get32(p + i + 2);
+    if(id == H2_SETTINGS_INITIAL_WINDOW_SIZE){
+      int k;
+      for(k = 0; k < c->num_streams; k++){
+        c->streams[k].window += (i64)v - c->peer_initial_window;
+      }
+      c->peer_initial_window = v;
+    } else if(id == H2_SETTINGS_MAX_FRAME_SIZE){
+      c->peer_max_frame = v;
+    }
+  }
+  return H2_NO_ERROR;
+}
+
+// Answer one request from the route table
+static void h2_respond(H2Conn* c, u32 stream, const char* path, int path_len, int head){
+  const Route* route = 0;
+  const char* block = h2_404_block;
+  int block_len = h2_404_block_len;
+  const char* body = "Not Found";
+  int body_len = 9;
+  int i;
+
+  SYSSTATS_REQUEST();
+
+  if(path){
+    for(i = 0; i < path_len; i++){
+      if(path[i] == '?'){ path_len = i; break; }
+    }
+    TRACE_BEGIN(t_route);
+    route = find_route(path, path_len);
+    TRACE_END(TRACE_ROUTE, c->fd, t_route);
+  }
+  if(route && !route->handler){
+    block = h2_route_blocks[route - routes];
+    block_len = h2_route_block_len[route - routes];
+    body = route->content;
+    body_len = route->content_len;
+  }
+  if(head) body_len = 0;
+
+  if(body_len > 0 && c->num_streams == H2_MAX_STREAMS){
+    h2_rst_stream(c, stream, H2_REFUSED_STREAM);
+    return;
+  }
+  h2_frame(c, H2_HEADERS, H2_FLAG_END_HEADERS | (body_len ? 0 : H2_FLAG_END_STREAM),
+           stream, block, block_len);
+  if(body_len > 0){
+    H2Stream* s = &c->streams[c->num_streams++];
+    s->id = stream;
+    s->data = body;
+    s->remaining = body_len;
+    s->window = c->peer_initial_window;
+  }
+}
+
+static void h2_end_headers(H2Conn* c, u32 stream, int is_request){
+  const char* path;
+  int path_len, head;
+  if(!hpack_decode(c, c->block, c->block_len, &path, &path_len, &head)){
+    h2_goaway(c, H2_COMPRESSION_ERROR);
+    return;
+  }
+  c->block_len = 0;
+  c->block_stream = 0;
+  // Trailers on a stream we already answered only keep HPACK in sync
+  if(is_request && !c->closing) h2_respond(c, stream, path, path_len, head);
+}
+
+static void h2_append_block(H2Conn* c, const char* p, int len){
+  if(c->block_len + len > H2_BLOCK_BUF){
+    h2_goaway(c, H2_PROTOCOL_ERROR);
+    return;
+  }
+  memcpy_manual(c->block + c->block_len, p, len);
+  c->block_len += len;
+}
+
+static void h2_remove_stream(H2Conn* c, u32 stream){
+  int i;
+  for(i = 0; i < c->num_streams; i++){
+    if(c->streams[i].id == stream){
+      c->streams[i] = c->streams[--c->num_streams];
+      return;
+    }
+  }
+}
+
+static void h2_handle_frame(H2Conn* c, int type, int flags, u32 stream, const char* p, int len){
+  // A header block must be continued without interleaving
+  if(c->block_stream && (type != H2_CONTINUATION || stream != c->block_stream)){
+    h2_goaway(c, H2_PROTOCOL_ERROR);
+    return;
+  }
+
+  switch(type){
+    case H2_DATA:
+      if(stream == 0){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+      // Request bodies are ignored; hand the connection window back in bulk
+      c->recv_unacked += len;
+      if(c->recv_unacked >= (1u << 30)){
+        h2_window_update(c, 0, (u32)c->recv_unacked);
+        c->recv_unacked = 0;
+      }
+      return;
+
+    case H2_HEADERS: {
+      int is_request;
+      if(stream == 0 || !(stream & 1)){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+      if(flags & H2_FLAG_PADDED){
+        int pad = len > 0 ? (unsigned char)p[0] : 0;
+        if(len < 1 + pad){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+        p++;
+        len -= 1 + pad;
+      }
+      if(flags & H2_FLAG_PRIORITY){
+        if(len < 5){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+        p += 5;
+        len -= 5;
+      }
+      is_request = stream > c->last_stream;
+      if(is_request) c->last_stream = stream;
+      h2_append_block(c, p, len);
+      if(c->closing) return;
+      if(flags & H2_FLAG_END_HEADERS){
+        h2_end_headers(c, stream, is_request);
+      } else {
+        c->block_stream = stream;
+        c->block_is_request = is_request;
+      }
+      return;
+    }
+
+    case H2_CONTINUATION:
+      if(stream == 0 || stream != c->block_stream){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+      h2_append_block(c, p, len);
+      if(!c->closing && (flags & H2_FLAG_END_HEADERS)){
+        h2_end_headers(c, stream, c->block_is_request);
+      }
+      return;
+
+    case H2_RST_STREAM:
+      if(len != 4){ h2_goaway(c, H2_FRAME_SIZE_ERROR); return; }
+      if(stream == 0 || stream > c->last_stream){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+      h2_remove_stream(c, stream);
+      return;
+
+    case H2_SETTINGS: {
+      int err;
+      if(stream != 0){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+      if(flags & H2_FLAG_ACK) return;
+      if(len % 6){ h2_goaway(c, H2_FRAME_SIZE_ERROR); return; }
+      err = h2_apply_settings(c, p, len);
+      if(err){ h2_goaway(c, err); return; }
+      h2_frame(c, H2_SETTINGS, H2_FLAG_ACK, 0, 0, 0);
+      return;
+    }
+
+    case H2_PING:
+      if(stream != 0 || len != 8){ h2_goaway(c, H2_FRAME_SIZE_ERROR); return; }
+      if(!(flags & H2_FLAG_ACK)) h2_frame(c, H2_PING, H2_FLAG_ACK, 0, p, 8);
+      return;
+
+    case H2_GOAWAY:
+      c->closing = 1;  // Finish what is in flight, then close
+      return;
+
+    case H2_WINDOW_UPDATE: {
+      u32 inc;
+      int i;
+      if(len != 4){ h2_goaway(c, H2_FRAME_SIZE_ERROR); return; }
+      inc = h2_get32(p) & 0x7fffffff;
+      if(stream == 0){
+        c->send_window += inc;
+        if(inc == 0) h2_goaway(c, H2_PROTOCOL_ERROR);
+        else if(c->send_window > H2_WINDOW_MAX) h2_goaway(c, H2_FLOW_CONTROL_ERROR);
+        return;
+      }
+      if(stream > c->last_stream){ h2_goaway(c, H2_PROTOCOL_ERROR); return; }
+      // Stream errors (RFC 9113 6.9, 6.9.1) reset only that stream
+      if(inc == 0){
+        h2_rst_stream(c, stream, H2_PROTOCOL_ERROR);
+        h2_remove_stream(c, stream);
+        return;
+      }
+      for(i = 0; i < c->num_streams; i++){
+        if(c->streams[i].id != stream) continue;
+        c->streams[i].window += inc;
+        if(c->streams[i].window > H2_WINDOW_MAX){
+          h2_rst_stream(c, stream, H2_FLOW_CONTROL_ERROR);
+          h2_remove_stream(c, stream);
+        }
+        break;
+      }
+      return;
+    }
+
+    case H2_PUSH_PROMISE:
+      h2_goaway(c, H2_PROTOCOL_ERROR);
+      return;
+
+    default:
+      return;  // PRIORITY and unknown frame types are ignored
+  }
+}
+
+// Queue DATA for pending streams as far as windows and buffer space allow
+static int h2_flush_streams(H2Conn* c){
+  int queued = 0;
+  int i = 0;
+  while(i < c->num_streams){
+    H2Stream* s = &c->streams[i];
+    i64 n = s->remaining;
+    if(n > c->peer_max_frame) n = c->peer_max_frame;
+    if(n > s->window) n = s->window;
+    if(n > c->send_window) n = c->send_window;
+    if(n > H2_OUT_BUF - c->out_len - 9) n = H2_OUT_BUF - c->out_len - 9;
+    if(n <= 0){
+      if(H2_OUT_BUF - c->out_len <= 9) break;
+      i++;
+      continue;
+    }
+
+    h2_frame(c, H2_DATA, n == s->remaining ? H2_FLAG_END_STREAM : 0, s->id, s->data, (int)n);
+    s->data += n;
+    s->remaining -= (int)n;
+    s->window -= n;
+    c->send_window -= n;
+    queued += (int)n;
+    if(s->remaining == 0){
+      *s = c->streams[--c->num_streams];
+    } else {
+      i++;
+    }
+  }
+  return queued;
+}
+
+static void h2_close(H2Conn* c){
+  sys(SYS_close, c->fd, 0, 0, 0, 0, 0);
+  c->used = 0;
+  h2_active--;
+}
+
+// Write as much output as the socket takes; returns 0 if the connection died
+static int h2_send(H2Conn* c){
+  if(c->out_len == 0) return 1;
+  TRACE_BEGIN(t_write);
+  i64 n = sys(SYS_sendto, c->fd, (i64)c->out, c->out_len, MSG_DONTWAIT | MSG_NOSIGNAL, 0, 0);
+  TRACE_END(TRACE_WRITE, c->fd, t_write);
+  if(n == -EAGAIN) return 1;
+  if(n <= 0){
+    h2_close(c);
+    return 0;
+  }
+  c->last_active_ns = monotonic_ns();
+  c->out_len -= (int)n;
+  memcpy_manual(c->out, c->out + n, c->out_len);
+  return 1;
+}
+
+// Process buffered input, then push output; closes the connection when done
+static void h2_progress(H2Conn* c){
+  int pos = 0;
+
+  // Client connection preface
+  while(c->preface_seen < (int)H2_PREFACE_LEN && pos < c->in_len){
+    if(c->in[pos++] != h2_preface[c->preface_seen++]){
+      h2_close(c);
+      return;
+    }
+  }
+
+  // After a GOAWAY keep reading only while streams still need WINDOW_UPDATEs
+  while(!(c->closing && c->num_streams == 0) && c->in_len - pos >= 9 &&
+        H2_OUT_BUF - c->out_len >= H2_OUT_RESERVE){
+    const unsigned char* h = (const unsigned char*)c->in + pos;
+    int len = (h[0] << 16) | (h[1] << 8) | h[2];
+    if(len > H2_MAX_FRAME){
+      h2_goaway(c, H2_FRAME_SIZE_ERROR);
+      break;
+    }
+    if(c->in_len - pos < 9 + len) break;
+    h2_handle_frame(c, h[3], h[4], h2_get32(c->in + pos + 5) & 0x7fffffff, c->in + pos + 9, len);
+    pos += 9 + len;
+  }
+  c->in_len -= pos;
+  memcpy_manual(c->in, c->in + pos, c->in_len);
+
+  for(;;){
+    int queued = h2_flush_streams(c);
+    if(!h2_send(c)) return;
+    if(queued == 0 || c->out_len > 0) break;
+  }
+
+  // After EOF no WINDOW_UPDATE can arrive: streams still blocked once the
+  // output is flushed never will be sent
+  if((c->eof || (c->closing && c->num_streams == 0)) && c->out_len == 0) h2_close(c);
+}
+
+static void h2_on_readable(H2Conn* c){
+  TRACE_BEGIN(t_read);
+  i64 n = sys(SYS_recvfrom, c->fd, (i64)(c->in + c->in_len), H2_IN_BUF - c->in_len, MSG_DONTWAIT, 0, 0);
+  TRACE_END(TRACE_READ, c->fd, t_read);
+  if(n == -EAGAIN) return;
+  if(n < 0){
+    h2_close(c);
+    return;
+  }
+  if(n == 0){
+    // Half-closed peer: still deliver what is queued, then close
+    c->eof = 1;
+    c->closing = 1;
+  } else {
+    c->last_active_ns = monotonic_ns();
+    c->in_len += (int)n;
+  }
+  h2_progress(c);
+}
+
+// ============================================================================
+// Entry points
+// ============================================================================
+static int h2_is_preface(const char* req, int req_len){
+  return req_len >= 16 && compare_strings(req, h2_preface, 16);  // "PRI * HTTP/2.0\r\n"
+}
+
+static H2Conn* h2_open(int fd){
+  int one = 1;
+  int i;
+  for(i = 0; i < H2_MAX_CONNS; i++){
+    H2Conn* c = &h2_conns[i];
+    if(c->used) continue;
+    // Frames are batched in out[] and sent per poll round; Nagle would only
+    // hold the tail back for the peer's delayed ACK (~40ms per round)
+    sys(SYS_setsockopt, fd, IPPROTO_TCP, TCP_NODELAY, (i64)&one, sizeof(one), 0);
+    c->used = 1;
+    c->fd = fd;
+    c->preface_seen = 0;
+    c->closing = 0;
+    c->eof = 0;
+    c->last_active_ns = monotonic_ns();
+    c->last_stream = 0;
+    c->block_stream = 0;
+    c->send_window = 65535;
+    c->peer_initial_window = 65535;
+    c->peer_max_frame = 16384;
+    c->recv_unacked = 0;
+    c->num_streams = 0;
+    c->in_len = 0;
+    c->out_len = 0;
+    c->block_len = 0;
+    c->table_len = 0;
+    c->table_size = 0;
+    c->table_max = H2_TABLE_SIZE;
+    h2_active++;
+    h2_server_preface(c);
+    return c;
+  }
+  return 0;
+}
+
+// Prior knowledge: req holds the preface and possibly the first frames.
+// Returns 0 if no connection slot is free.
+static int h2_accept(int fd, const char* req, int req_len){
+  H2Conn* c = h2_open(fd);
+  if(!c) return 0;
+  memcpy_manual(c->in, req, req_len);
+  c->in_len = req_len;
+  h2_progress(c);
+  return 1;
+}
+
+// Client side of a prior-knowledge exchange for the startup warmup: the
+// preface, an empty SETTINGS, one GET per path (streams 1, 3, ...) and a
+// GOAWAY so the server closes once everything is answered. Returns the
+// length, or 0 if it does not fit.
+static int h2_warm_request(char* out, int cap, const char* const* paths, const int* path_lens, int n){
+  int len = H2_PREFACE_LEN;
+  int i;
+  if(cap < len + 9 + 17) return 0;
+  memcpy_manual(out, h2_preface, H2_PREFACE_LEN);
+  out[len++] = 0; out[len++] = 0; out[len++] = 0;  // SETTINGS, empty
+  out[len++] = H2_SETTINGS; out[len++] = 0;
+  h2_put32(out + len, 0);
+  len += 4;
+  for(i = 0; i < n; i++){
+    int block;
+    if(cap - len < 9 + 3 + 5 + path_lens[i] + 17) return 0;
+    block = 0;
+    out[len + 9 + block++] = (char)0x82;  // :method GET
+    out[len + 9 + block++] = (char)0x86;  // :scheme http
+    block += hpack_put_literal(out + len + 9 + block, 4, paths[i], path_lens[i]);  // :path
+    out[len] = (char)(block >> 16); out[len + 1] = (char)(block >> 8); out[len + 2] = (char)block;
+    out[len + 3] = H2_HEADERS;
+    out[len + 4] = H2_FLAG_END_HEADERS | H2_FLAG_END_STREAM;
+    h2_put32(out + len + 5, 2 * i + 1);
+    len += 9 + block;
+  }
+  out[len++] = 0; out[len++] = 0; out[len++] = 8;  // GOAWAY, last stream 0, NO_ERROR
+  out[len++] = H2_GOAWAY; out[len++] = 0;
+  h2_put32(out + len, 0);
+  h2_put32(out + len + 4, 0);
+  h2_put32(out + len + 8, H2_NO_ERROR);
+  return len + 12;
+}
+
+static int h2_base64url_value(char ch){
+  if(ch >= 'A' && ch <= 'Z') return ch - 'A';
+  if(ch >= 'a' && ch <= 'z') return ch - 'a' + 26;
+  if(ch >= '0' && ch <= '9') return ch - '0' + 52;
+  if(ch == '-' || ch == '+') return 62;
+  if(ch == '_' || ch == '/') return 63;
+  return -1;
+}
+
+// "Upgrade: h2c" with HTTP2-Settings: answer 101 and serve the request as
+// stream 1. Returns 0 to fall back to HTTP/1.
+static int h2_upgrade(int fd, const char* req, int req_len, const char* path, int path_len, int head){
+  static const char switching[] =
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Connection: Upgrade\r\n"
+    "Upgrade: h2c\r\n"
+    "\r\n";
+  const char* v;
+  int v_len;
+  char settings[64];
+  int settings_len = 0;
+  u32 acc = 0;
+  int acc_bits = 0;
+  int i;
+
+  if(!find_header(req, req_len, "upgrade", 7, &v, &v_len) || !contains(v, v_len, "h2c", 3)) return 0;
+  if(!find_header(req, req_len, "http2-settings", 14, &v, &v_len)) return 0;
+
+  for(i = 0; i < v_len; i++){
+    int d = h2_base64url_value(v[i]);
+    if(d < 0) break;  // '=' padding or end of token
+    acc = (acc << 6) | d;
+    acc_bits += 6;
+    if(acc_bits >= 8){
+      acc_bits -= 8;
+      if(settings_len == sizeof(settings)) return 0;
+      settings[settings_len++] = (char)(acc >> acc_bits);
+    }
+  }
+
+  // Bad settings fall back to HTTP/1 before a slot is taken: the fd stays
+  // with handle_request
+  settings_len -= settings_len % 6;
+  if(h2_check_settings(settings, settings_len) != H2_NO_ERROR) return 0;
+
+  H2Conn* c = h2_open(fd);
+  if(!c) return 0;
+  h2_apply_settings(c, settings, settings_len);
+
+  sys(SYS_write, fd, (i64)switching, sizeof(switching) - 1, 0, 0, 0);
+  c->last_stream = 1;
+  h2_respond(c, 1, path, path_len, head);
+  h2_progress(c);
+  return 1;
+}
+
+// ============================================================================
+// Main loop integration
+// ============================================================================
+static H2Conn* h2_poll_conns[H2_MAX_CONNS];
+
+// Close connections that moved no bytes for H2_IDLE_NS, so idle or stalled
+// clients cannot hold every slot
+static void h2_expire_idle(u64 now_ns){
+  int i;
+  if(h2_active == 0) return;
+  for(i = 0; i < H2_MAX_CONNS; i++){
+    H2Conn* c = &h2_conns[i];
+    if(!c->used || now_ns - c->last_active_ns < H2_IDLE_NS) continue;
+    if(!c->eof && c->out_len == 0){
+      h2_goaway(c, H2_NO_ERROR);
+      sys(SYS_sendto, c->fd, (i64)c->out, c->out_len, MSG_DONTWAIT | MSG_NOSIGNAL, 0, 0);
+    }
+    h2_close(c);
+  }
+}
+
+static int h2_fill_pollfds(struct pollfd* pfd){
+  int n = 0;
+  int i;
+  if(h2_active == 0) return 0;
+  for(i = 0; i < H2_MAX_CONNS; i++){
+    H2Conn* c = &h2_conns[i];
+    if(!c->used) continue;
+    pfd[n].fd = c->fd;
+    pfd[n].events = 0;
+    if(!c->eof && !(c->closing && c->num_streams == 0) && c->in_len < H2_IN_BUF &&
+       H2_OUT_BUF - c->out_len >= H2_OUT_RESERVE){
+      pfd[n].events |= POLLIN;
+    }
+    if(c->out_len > 0) pfd[n].events |= POLLOUT;
+    pfd[n].revents = 0;
+    h2_poll_conns[n++] = c;
+  }
+  return n;
+}
+
+static void h2_handle_pollfds(const struct pollfd* pfd, int n){
+  int i;
+  for(i = 0; i < n; i++){
+    H2Conn* c = h2_poll_conns[i];
+    short re = pfd[i].revents;
+    if(!re) continue;
+    if(re & POLLIN){
+      h2_on_readable(c);
+    } else if(re & POLLOUT){
+      h2_progress(c);
+    } else {
+      h2_close(c);  // POLLERR / POLLHUP with nothing left to read
+    }
+  }
+}
@@ -1,6 +1,11 @@
 #include "lyrics.h"
 #include "sys.h"
 #include "notstdlib.h"
+#include "trace.h"
+// bench/bench.c defines DIGGY_BENCH to keep the route table fixed
+#if __has_include("assets.h") && !defined(DIGGY_BENCH)
+#  include "assets.h"  // Generated by tools/assetc.c
+#endif
 
 // ============================================================================
 // Add syscalls for file operations
@@ -14,6 +19,12 @@
 #  define O_RDONLY 0
 #endif
 
+#include "sysstats.h"  // Names SYS_open/SYS_openat above
+
+#if defined(DIGGY_TRACE) || defined(DIGGY_SYSSTATS)
+#  define DIGGY_DEBUG_SIGNALS
+#endif
+
 // ============================================================================
 // Configuration structure
 // ============================================================================
@@ -23,6 +34,10 @@ typedef struct {
   int interval_ms;
   int poll_timeout_ms;
   int mine;
+  int workers;
+  int cpu_affinity;
+  int hugepages;  // Hot region: 0 = 4 KiB pages, 1 = transparent, 2 = hugetlbfs
+  int mlock;
 } Config;
 
 // Default configuration
@@ -31,7 +46,11 @@ static Config config = {
   .host = 0,  // INADDR_ANY
   .interval_ms = 2000,
   .poll_timeout_ms = 100,
-  .mine = 1
+  .mine = 1,
+  .workers = 1,
+  .cpu_affinity = 0,
+  .hugepages = 1,
+  .mlock = 0
 };
 
 // ============================================================================
@@ -133,6 +152,10 @@ static void load_config(const char* filename){
   static const char msg4[] = "\n  poll_timeout_ms: ";
   static const char msg5[] = "\n  mine: ";
   static const char msg6[] = "\n";
+  static const char msg7[] = "\n  workers: ";
+  static const char msg8[] = "\n  cpu_affinity: ";
+  static const char msg9[] = "\n  hugepages: ";
+  static const char msg10[] = "\n  mlock: ";
   char num_buf[12];
   int num_len;
 
@@ -154,6 +177,22 @@ static void load_config(const char* filename){
   num_len = itoa(config.mine, num_buf);
   sys(SYS_write, 1, (i64)num_buf, num_len, 0, 0, 0);
 
+  sys(SYS_write, 1, (i64)msg7, sizeof(msg7) - 1, 0, 0, 0);
+  num_len = itoa(config.workers, num_buf);
+  sys(SYS_write, 1, (i64)num_buf, num_len, 0, 0, 0);
+
+  sys(SYS_write, 1, (i64)msg8, sizeof(msg8) - 1, 0, 0, 0);
+  num_len = itoa(config.cpu_affinity, num_buf);
+  sys(SYS_write, 1, (i64)num_buf, num_len, 0, 0, 0);
+
+  sys(SYS_write, 1, (i64)msg9, sizeof(msg9) - 1, 0, 0, 0);
+  num_len = itoa(config.hugepages, num_buf);
+  sys(SYS_write, 1, (i64)num_buf, num_len, 0, 0, 0);
+
+  sys(SYS_write, 1, (i64)msg10, sizeof(msg10) - 1, 0, 0, 0);
+  num_len = itoa(config.mlock, num_buf);
+  sys(SYS_write, 1, (i64)num_buf, num_len, 0, 0, 0);
+
   sys(SYS_write, 1, (i64)msg6, sizeof(msg6) - 1, 0, 0, 0);
 }
 
@@ -168,6 +207,22 @@ typedef struct {
   const char* content_type;
   int path_len;  // Will be calculated at runtime
   int content_type_len;  // Pre-calculated content type length
+  void (*handler)(int client_fd);  // Dynamic route, takes ownership of client_fd
+  int content_len;  // Calculated at runtime unless generated
+  // Pre-rendered responses (generated assets), served without building
+  const char* response;
+  int response_len;
+  const char* response_gz;
+  int response_gz_len;
+  const char* etag;
+  int etag_len;
+  const char* not_modified;
+  int not_modified_len;
+  // The gzip variant has its own strong ETag and 304
+  const char* etag_gz;
+  int etag_gz_len;
+  const char* not_modified_gz;
+  int not_modified_gz_len;
 } Route;
 
 // Example static content (add more as needed)
@@ -175,17 +230,137 @@ static const char health_content[] = "OK";
 static const char about_content[] = "This is a simple HTTP server";
 static const char info_content[] = "Server v1.0.0\nMinimal HTTP implementation";
 
+// ============================================================================
+// Server-Sent Events: every /stream subscriber gets each mined line
+// Subscribers are not polled; they only cost a send per tick. The kernel
+// send buffer is the per-subscriber queue, capped at STREAM_HWM_BYTES, and a
+// subscriber that cannot take a whole event is dropped.
+// ============================================================================
+#define STREAM_MAX_SUBSCRIBERS 65536
+#define STREAM_FD_HEADROOM 16  // stdio, listener, signalfd, requests in flight
+#define STREAM_HWM_BYTES 16384
+#define STREAM_MAX_EVENT 1024
+
+static int stream_fds[STREAM_MAX_SUBSCRIBERS];
+static int stream_count;
+static int stream_max = STREAM_MAX_SUBSCRIBERS;
+
+// Subscribers may use the fd limit minus the headroom, so plain requests
+// and the listener never starve behind them
+static void stream_set_fd_limit(u64 nofile){
+  if(nofile < STREAM_FD_HEADROOM) stream_max = 0;
+  else if(nofile - STREAM_FD_HEADROOM < STREAM_MAX_SUBSCRIBERS) stream_max = (int)(nofile - STREAM_FD_HEADROOM);
+}
+
+static void stream_handler(int client_fd){
+  static const char hdr[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+  static const char busy[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+  if(stream_count >= stream_max){
+    sys(SYS_write, client_fd, (i64)busy, sizeof(busy) - 1, 0, 0, 0);
+    sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
+    return;
+  }
+
+  int sndbuf = STREAM_HWM_BYTES;
+  sys(SYS_setsockopt, client_fd, SOL_SOCKET, SO_SNDBUF, (i64)&sndbuf, sizeof(sndbuf), 0);
+
+  if(sys(SYS_sendto, client_fd, (i64)hdr, sizeof(hdr) - 1, MSG_DONTWAIT | MSG_NOSIGNAL, 0, 0) != sizeof(hdr) - 1){
+    sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
+    return;
+  }
+  stream_fds[stream_count++] = client_fd;
+}
+
+// Format the event once and fan it out with non-blocking sends
+static void stream_broadcast(const char* line, int line_len){
+  static const char prefix[] = "data: ";
+  char event[STREAM_MAX_EVENT];
+  int len = 0;
+  int i;
+
+  if(stream_count == 0) return;
+
+  if(line_len > (int)sizeof(event) - (int)(sizeof(prefix) - 1) - 2){
+    line_len = sizeof(event) - (sizeof(prefix) - 1) - 2;
+  }
+  memcpy_manual(event, prefix, sizeof(prefix) - 1);
+  len += sizeof(prefix) - 1;
+  memcpy_manual(event + len, line, line_len);
+  len += line_len;
+  event[len++] = '\n';
+  event[len++] = '\n';
+
+  for(i = 0; i < stream_count; ){
+    int fd = stream_fds[i];
+    if(sys(SYS_sendto, fd, (i64)event, len, MSG_DONTWAIT | MSG_NOSIGNAL, 0, 0) != len){
+      // Gone or past the high-water mark: drop, swap in the last subscriber
+      sys(SYS_close, fd, 0, 0, 0, 0, 0);
+      stream_fds[i] = stream_fds[--stream_count];
+      continue;
+    }
+    i++;
+  }
+}
+
+#ifdef DIGGY_SYSSTATS
+// Report syscall counts and cost per request
+static void debug_syscalls_handler(int client_fd){
+  static const char hdr[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Connection: close\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "\r\n";
+  sys(SYS_write, client_fd, (i64)hdr, sizeof(hdr) - 1, 0, 0, 0);
+  sysstats_report(client_fd);
+  sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
+}
+#endif
+
+#ifdef DIGGY_TRACE
+// Dump the span ring as Chrome trace-event JSON
+static void debug_trace_handler(int client_fd){
+  static const char hdr[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Connection: close\r\n"
+    "Content-Type: application/json\r\n"
+    "\r\n";
+  sys(SYS_write, client_fd, (i64)hdr, sizeof(hdr) - 1, 0, 0, 0);
+  trace_dump(client_fd);
+  sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
+}
+#endif
 
 // ============================================================================
 // ROUTE TABLE - Add new routes here!
 // Path lengths will be calculated at initialization
 // ============================================================================
 static const char content_type[] = "text/plain; charset=utf-8";
+// tools/assetc.c rejects assets at these paths; keep its builtin_routes in sync
 static Route routes[] = {
   {"/",  content, content_type},
   {"/health", health_content,  content_type},
   {"/about",  about_content,  content_type},
   {"/info", info_content,  content_type},
+  {"/stream", .handler = stream_handler},
+#ifdef ASSET_ROUTES
+  ASSET_ROUTES
+#endif
+#ifdef DIGGY_TRACE
+  {"/debug/trace", .handler = debug_trace_handler},
+#endif
+#ifdef DIGGY_SYSSTATS
+  {"/debug/syscalls", .handler = debug_syscalls_handler},
+#endif
 };
 #define NUM_ROUTES (sizeof(routes) / sizeof(routes[0]))
 
@@ -195,8 +370,14 @@ static Route routes[] = {
 static void init_routes(void){
   int i;
   for(i = 0; i < NUM_ROUTES; i++){
+    if(routes[i].response) continue;  // Generated, lengths already known
     routes[i].path_len = str_len(routes[i].path);
-    routes[i].content_type_len = str_len(routes[i].content_type);
+    if(routes[i].content_type){
+      routes[i].content_type_len = str_len(routes[i].content_type);
+    }
+    if(routes[i].content){
+      routes[i].content_len = str_len(routes[i].content);
+    }
   }
 }
 static const Route* find_route(const char* path, int path_len){
@@ -216,9 +397,7 @@ static int build_response(const Route* route, char* buf, int buf_size){
   static const char h2[] = "\r\nConnection: close\r\nContent-Type: ";
   static const char h3[] = "\r\n\r\n";
 
-  int content_len = 0;
-  const volatile char* p = (const volatile char*)route->content;
-  while(p[content_len]) content_len++;
+  int content_len = route->content_len;
 
   char len_str[12];
   int len_digits = itoa(content_len, len_str);
@@ -289,47 +468,213 @@ static int extract_path(const char* req, int req_len, const char** path_start, i
 }
 
 
-// Handle HTTP request
-static void handle_request(int client_fd){
+// Find a header value in the request (name lower-case, matched case-insensitively)
+static int find_header(const char* req, int req_len, const char* name, int name_len,
+                       const char** value, int* value_len){
+  int i = 0;
+
+  // Skip request line
+  while(i < req_len && req[i] != '\n') i++;
+  i++;
+
+  while(i < req_len){
+    int start = i;
+    while(i < req_len && req[i] != '\n') i++;
+    int line_len = i - start;
+    if(line_len > 0 && req[start + line_len - 1] == '\r') line_len--;
+    if(line_len == 0) return 0;  // End of headers
+
+    if(line_len > name_len && req[start + name_len] == ':'){
+      int j;
+      for(j = 0; j < name_len; j++){
+        if((req[start + j] | 0x20) != name[j]) break;
+      }
+      if(j == name_len){
+        int v = start + name_len + 1;
+        int end = start + line_len;
+        while(v < end && req[v] == ' ') v++;
+        *value = req + v;
+        *value_len = end - v;
+        return 1;
+      }
+    }
+    i++;
+  }
+  return 0;
+}
+
+static int contains(const char* s, int len, const char* needle, int needle_len){
+  int i;
+  for(i = 0; i + needle_len <= len; i++){
+    if(compare_strings(s + i, needle, needle_len)) return 1;
+  }
+  return 0;
+}
+
+// Case-insensitive compare against a lowercase literal
+static int equals_lower(const char* s, const char* lower, int len){
+  int i;
+  for(i = 0; i < len; i++){
+    if((s[i] | 0x20) != lower[i]) return 0;
+  }
+  return 1;
+}
+
+// Accept-Encoding allows gzip: an explicit "gzip" (or "x-gzip") element
+// wins over "*", and a q-value of zero refuses the coding
+static int accepts_gzip(const char* v, int len){
+  int gzip = -1, any = -1;
+  int i = 0;
+  while(i < len){
+    while(i < len && (v[i] == ' ' || v[i] == '\t' || v[i] == ',')) i++;
+    int name = i;
+    while(i < len && v[i] != ',' && v[i] != ';' && v[i] != ' ' && v[i] != '\t') i++;
+    int name_len = i - name;
+    int q = 1;
+    while(i < len && v[i] != ','){
+      if(v[i] == ';'){
+        i++;
+        while(i < len && (v[i] == ' ' || v[i] == '\t')) i++;
+        if(i + 1 < len && (v[i] | 0x20) == 'q' && v[i + 1] == '='){
+          q = 0;
+          for(i += 2; i < len && v[i] != ',' && v[i] != ';'; i++){
+            if(v[i] >= '1' && v[i] <= '9') q = 1;
+          }
+          continue;
+        }
+      }
+      i++;
+    }
+    if((name_len == 4 && equals_lower(v + name, "gzip", 4)) ||
+       (name_len == 6 && equals_lower(v + name, "x-gzip", 6))) gzip = q;
+    else if(name_len == 1 && v[name] == '*') any = q;
+  }
+  return gzip >= 0 ? gzip : any > 0;
+}
+
+// Pick the pre-rendered response for a generated asset
+static void select_rendered(const Route* route, const char* req, int req_len,
+                            const char** resp, int* resp_len){
+  const char* v;
+  int v_len;
+
+  if(find_header(req, req_len, "if-none-match", 13, &v, &v_len) &&
+     contains(v, v_len, route->etag, route->etag_len)){
+    *resp = route->not_modified;
+    *resp_len = route->not_modified_len;
+  } else if(route->response_gz &&
+            find_header(req, req_len, "if-none-match", 13, &v, &v_len) &&
+            contains(v, v_len, route->etag_gz, route->etag_gz_len)){
+    *resp = route->not_modified_gz;
+    *resp_len = route->not_modified_gz_len;
+  } else if(route->response_gz &&
+            find_header(req, req_len, "accept-encoding", 15, &v, &v_len) &&
+            accepts_gzip(v, v_len)){
+    *resp = route->response_gz;
+    *resp_len = route->response_gz_len;
+  } else {
+    *resp = route->response;
+    *resp_len = route->response_len;
+  }
+}
+
+#include "h2.h"
+
+// Per-connection buffers, allocated and prefaulted with the route payloads
+// by setup_hot_region() so the first request never takes a page fault. The
+// h2 connection pool (~10 MiB) is mapped separately and faulted per slot.
+typedef struct {
   char req_buf[512];
   char resp_buf[MAX_RESPONSE_SIZE];
+  char h2_scratch[H2_SCRATCH_SIZE];
+} HotRegion;
+
+static HotRegion* hot;
+
+// Handle HTTP request
+static void handle_request(int client_fd){
+  char* req_buf = hot->req_buf;
+  char* resp_buf = hot->resp_buf;
 
   // Read request
-  int req_len = (int)sys(SYS_read, client_fd, (i64)req_buf, sizeof(req_buf), 0, 0, 0);
+  TRACE_BEGIN(t_read);
+  int req_len = (int)sys(SYS_read, client_fd, (i64)req_buf, sizeof(hot->req_buf), 0, 0, 0);
+  TRACE_END(TRACE_READ, client_fd, t_read);
   if(req_len <= 0){
     sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
     return;
   }
 
+  // HTTP/2 with prior knowledge: the connection moves to the h2 table
+  if(h2_is_preface(req_buf, req_len)){
+    if(!h2_accept(client_fd, req_buf, req_len)){
+      sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
+    }
+    return;
+  }
+
   // Extract path
   const char* path;
   int path_len;
-  if(!extract_path(req_buf, req_len, &path, &path_len)){
-    // Invalid request, send 404
-    int resp_len = build_404_response(resp_buf, sizeof(resp_buf));
-    if(resp_len > 0){
-      sys(SYS_write, client_fd, (i64)resp_buf, resp_len, 0, 0, 0);
-    }
+  TRACE_BEGIN(t_parse);
+  int parsed = extract_path(req_buf, req_len, &path, &path_len);
+  TRACE_END(TRACE_PARSE, client_fd, t_parse);
+
+  // Find route, invalid requests get a 404
+  const Route* route = 0;
+  if(parsed){
+    TRACE_BEGIN(t_route);
+    route = find_route(path, path_len);
+    TRACE_END(TRACE_ROUTE, client_fd, t_route);
+  }
+
+  if(route && route->handler){
+    SYSSTATS_REQUEST();
+    route->handler(client_fd);
+    return;
+  }
+
+  // Upgrade: h2c, the request is answered as stream 1
+  if(parsed && h2_upgrade(client_fd, req_buf, req_len, path, path_len,
+                          req_len > 5 && compare_strings(req_buf, "HEAD ", 5))){
+    return;
+  }
+
+  // h2 counts per stream in h2_respond
+  SYSSTATS_REQUEST();
+
+  if(route && route->response){
+    const char* resp;
+    int resp_len;
+    select_rendered(route, req_buf, req_len, &resp, &resp_len);
+    TRACE_BEGIN(t_write);
+    sys(SYS_write, client_fd, (i64)resp, resp_len, 0, 0, 0);
+    TRACE_END(TRACE_WRITE, client_fd, t_write);
+    TRACE_BEGIN(t_close);
     sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
+    TRACE_END(TRACE_CLOSE, client_fd, t_close);
     return;
   }
 
-  // Find route
-  const Route* route = find_route(path, path_len);
   int resp_len;
-
+  TRACE_BEGIN(t_build);
   if(route){
-    resp_len = build_response(route, resp_buf, sizeof(resp_buf));
+    resp_len = build_response(route, resp_buf, sizeof(hot->resp_buf));
   } else {
-    resp_len = build_404_response(resp_buf, sizeof(resp_buf));
+    resp_len = build_404_response(resp_buf, sizeof(hot->resp_buf));
   }
+  TRACE_END(TRACE_BUILD, client_fd, t_build);
 
   // Send response
   if(resp_len > 0){
+    TRACE_BEGIN(t_write);
     sys(SYS_write, client_fd, (i64)resp_buf, resp_len, 0, 0, 0);
+    TRACE_END(TRACE_WRITE, client_fd, t_write);
   }
 
+  TRACE_BEGIN(t_close);
   sys(SYS_close, client_fd, 0, 0, 0, 0, 0);
+  TRACE_END(TRACE_CLOSE, client_fd, t_close);
 }
 
 // ============================================================================
@@ -346,27 +691,45 @@ static int find_next_line(const char* str, int start, int total_len, int* line_s
   return 1;
 }
 
-static void print_next_line(int* current_pos){
-  // Only print if mining is enabled
-  if(!config.mine) return;
+static int lines_len;
+static int num_lines;
 
+// Count the lines once at startup
+static void init_lines(void){
   // Calculate content length at runtime
-  int content_len = 0;
   const volatile char* p = (const volatile char*)content;
-  while(p[content_len]) content_len++;
+  while(p[lines_len]) lines_len++;
 
-  int line_start, line_len;
+  int i;
+  for(i = 0; i < lines_len; i++){
+    if(content[i] == '\n') num_lines++;
+  }
+  if(lines_len > 0 && content[lines_len - 1] != '\n') num_lines++;
+}
 
-  if(find_next_line(content, *current_pos, content_len, &line_start, &line_len)){
-    sys(SYS_write, 1, (i64)(content + line_start), line_len, 0, 0, 0);
-    sys(SYS_write, 1, (i64)"\n", 1, 0, 0, 0);
+// Print and stream line `tick` of the content, wrapping around. Ticks are
+// counted on the monotonic clock from a start time taken before the fork,
+// so every worker sends the same line at the same time whichever worker a
+// subscriber landed on.
+static void print_line(u64 tick){
+  // Nobody to show it to
+  if(!config.mine && !stream_count) return;
+  if(num_lines == 0) return;
+
+  int skip = (int)(tick % (u64)num_lines);
+  int pos = 0;
+  while(skip-- > 0){
+    while(content[pos] != '\n') pos++;
+    pos++;
+  }
 
-    *current_pos = line_start + line_len;
-    if(*current_pos < content_len && content[*current_pos] == '\n'){
-      (*current_pos)++;
+  int line_start, line_len;
+  if(find_next_line(content, pos, lines_len, &line_start, &line_len)){
+    if(config.mine){
+      sys(SYS_write, 1, (i64)(content + line_start), line_len, 0, 0, 0);
+      sys(SYS_write, 1, (i64)"\n", 1, 0, 0, 0);
     }
-  } else {
-    *current_pos = 0;  // Start over
+    stream_broadcast(content + line_start, line_len);
   }
 }
 
@@ -408,6 +771,18 @@ static void parse_env_var(const char* kv, int len) {
   } else if(key_len == 4 && str_equals(key, "MINE", 4)){
     config.mine = str_to_int(value, value_len);
     applied = 1;
+  } else if(key_len == 7 && str_equals(key, "WORKERS", 7)){
+    config.workers = str_to_int(value, value_len);
+    applied = 1;
+  } else if(key_len == 12 && str_equals(key, "CPU_AFFINITY", 12)){
+    config.cpu_affinity = str_to_int(value, value_len);
+    applied = 1;
+  } else if(key_len == 9 && str_equals(key, "HUGEPAGES", 9)){
+    config.hugepages = str_to_int(value, value_len);
+    applied = 1;
+  } else if(key_len == 5 && str_equals(key, "MLOCK", 5)){
+    config.mlock = str_to_int(value, value_len);
+    applied = 1;
   }
 
   // Print loaded env var in "KEY=VALUE" form once applied
@@ -468,6 +843,18 @@ static int apply_config_kv(const char* key, int key_len, const char* value, int
   } else if(key_len == 4 && str_equals(key, "mine", 4)){
     config.mine = str_to_int(value, value_len);
     return 1;
+  } else if(key_len == 7 && str_equals(key, "workers", 7)){
+    config.workers = str_to_int(value, value_len);
+    return 1;
+  } else if(key_len == 12 && str_equals(key, "cpu_affinity", 12)){
+    config.cpu_affinity = str_to_int(value, value_len);
+    return 1;
+  } else if(key_len == 9 && str_equals(key, "hugepages", 9)){
+    config.hugepages = str_to_int(value, value_len);
+    return 1;
+  } else if(key_len == 5 && str_equals(key, "mlock", 5)){
+    config.mlock = str_to_int(value, value_len);
+    return 1;
   }
   return 0;
 }
@@ -493,7 +880,8 @@ static void parse_config_line(const char* line, int len){
 
 // ============================================================================
 // CLI args: parse argv from initial stack
-// Supports: -port=, -host=, -interval_ms=, -poll_timeout_ms=, -mine=
+// Supports: -port=, -host=, -interval_ms=, -poll_timeout_ms=, -mine=,
+//           -workers=, -cpu_affinity=, -hugepages=, -mlock=
 // ============================================================================
 
 static void load_cli_overrides(void){
@@ -552,6 +940,425 @@ static void load_cli_overrides(void){
   }
 }
 
+#ifdef DIGGY_DEBUG_SIGNALS
+// ============================================================================
+// Debug signals: delivered through a signalfd polled by the main loop
+// SIGUSR1 dumps the span ring to stdout
+// SIGUSR2 prints the syscall report; SIGTERM/SIGINT print it and exit
+// ============================================================================
+static int setup_debug_signals(void){
+  u64 mask = 0;
+#ifdef DIGGY_TRACE
+  mask |= 1ul << (SIGUSR1 - 1);
+#endif
+#ifdef DIGGY_SYSSTATS
+  mask |= (1ul << (SIGUSR2 - 1)) | (1ul << (SIGTERM - 1)) | (1ul << (SIGINT - 1));
+#endif
+  sys(SYS_rt_sigprocmask, SIG_BLOCK, (i64)&mask, 0, sizeof(mask), 0, 0);
+  return (int)sys(SYS_signalfd4, -1, (i64)&mask, sizeof(mask), 0, 0, 0);
+}
+
+static void handle_debug_signal(int sfd){
+  struct signalfd_siginfo si;
+  if(sys(SYS_read, sfd, (i64)&si, sizeof(si), 0, 0, 0) != sizeof(si)) return;
+#ifdef DIGGY_TRACE
+  if(si.ssi_signo == SIGUSR1){
+    trace_dump(1);
+  }
+#endif
+#ifdef DIGGY_SYSSTATS
+  if(si.ssi_signo == SIGUSR2){
+    sysstats_report(1);
+  } else if(si.ssi_signo == SIGTERM || si.ssi_signo == SIGINT){
+    sysstats_report(1);
+    sys(SYS_exit, 0, 0, 0, 0, 0, 0);
+  }
+#endif
+}
+#endif
+
+// ============================================================================
+// Workers: one process per listener in a SO_REUSEPORT group
+// With cpu_affinity=1 worker i is pinned to the i-th CPU of the affinity mask
+// the server was started with, and a classic BPF program steers connections
+// received on that CPU to socket i, so the softirq, accept and response all
+// stay on one core. Other CPUs fall back to (receiving CPU % workers).
+// ============================================================================
+#define MAX_WORKERS 256
+#define MAX_CPUS 1024
+
+static int usable_cpus[MAX_CPUS];
+static int num_usable_cpus;
+
+// CPUs this process may run on, in ascending order
+static void read_usable_cpus(void){
+  u64 mask[MAX_CPUS / 64] = {0};
+  int i;
+  if(sys(SYS_sched_getaffinity, 0, sizeof(mask), (i64)mask, 0, 0, 0) <= 0) return;
+  for(i = 0; i < MAX_CPUS; i++){
+    if((mask[i / 64] >> (i % 64)) & 1) usable_cpus[num_usable_cpus++] = i;
+  }
+}
+
+static int open_listener(int reuseport){
+  int sock = (int)sys(SYS_socket, AF_INET, SOCK_STREAM, 0, 0, 0, 0);
+  int one = 1;
+  sys(SYS_setsockopt, sock, SOL_SOCKET, SO_REUSEADDR, (i64)&one, sizeof(one), 0);
+  if(reuseport){
+    sys(SYS_setsockopt, sock, SOL_SOCKET, SO_REUSEPORT, (i64)&one, sizeof(one), 0);
+  }
+
+  // Bind and listen using config values
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(config.port);
+  addr.sin_addr.s_addr = config.host;  // Use configured host
+
+  sys(SYS_bind, sock, (i64)&addr, sizeof(addr), 0, 0, 0);
+  sys(SYS_listen, sock, 128, 0, 0, 0, 0);
+  return sock;
+}
+
+static void attach_cpu_steering(int sock, int workers){
+  // One compare-and-return per usable CPU, well under BPF_MAXINSNS (4096)
+  static struct sock_filter code[2 * MAX_CPUS + 3];
+  int n = 0;
+  int i;
+  code[n++] = (struct sock_filter){ BPF_LD_W_ABS, 0, 0, (u32)SKF_AD_CPU };
+  for(i = 0; i < num_usable_cpus; i++){
+    code[n++] = (struct sock_filter){ BPF_JEQ_K, 0, 1, (u32)usable_cpus[i] };
+    code[n++] = (struct sock_filter){ BPF_RET_K, 0, 0, (u32)(i % workers) };
+  }
+  code[n++] = (struct sock_filter){ BPF_ALU_MOD_K, 0, 0, (u32)workers };
+  code[n++] = (struct sock_filter){ BPF_RET_A, 0, 0, 0 };
+  struct sock_fprog prog = { (u16)n, code };
+  if(sys(SYS_setsockopt, sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, (i64)&prog, sizeof(prog), 0) < 0){
+    static const char msg[] = "cpu_affinity: cannot attach reuseport CBPF, using kernel hash\n";
+    sys(SYS_write, 1, (i64)msg, sizeof(msg) - 1, 0, 0, 0);
+  }
+}
+
+static void pin_worker(int worker, int sock){
+  u64 mask[MAX_CPUS / 64] = {0};
+  int cpu = usable_cpus[worker];
+  mask[cpu / 64] = 1ul << (cpu % 64);
+  if(sys(SYS_sched_setaffinity, 0, sizeof(mask), (i64)mask, 0, 0, 0) < 0){
+    static const char msg[] = "cpu_affinity: cannot pin worker to CPU ";
+    char num[12];
+    sys(SYS_write, 1, (i64)msg, sizeof(msg) - 1, 0, 0, 0);
+    sys(SYS_write, 1, (i64)num, itoa(cpu, num), 0, 0, 0);
+    sys(SYS_write, 1, (i64)"\n", 1, 0, 0, 0);
+    return;
+  }
+  sys(SYS_setsockopt, sock, SOL_SOCKET, SO_INCOMING_CPU, (i64)&cpu, sizeof(cpu), 0);
+}
+
+static i64 worker_pids[MAX_WORKERS];
+
+// Fork workers-1 children; returns this process' worker index
+static int spawn_workers(int workers){
+  i64 parent = sys(SYS_getpid, 0, 0, 0, 0, 0, 0);
+  int i;
+  for(i = 1; i < workers; i++){
+    i64 pid = sys(SYS_clone, SIGCHLD, 0, 0, 0, 0, 0);
+    if(pid == 0){
+      // Do not outlive worker 0 (SIGTERM so a SYSSTATS build reports first).
+      // If it died before the prctl, the signal will never come: leave now
+      sys(SYS_prctl, PR_SET_PDEATHSIG, SIGTERM, 0, 0, 0, 0);
+      if(sys(SYS_getppid, 0, 0, 0, 0, 0, 0) != parent) sys(SYS_exit, 0, 0, 0, 0, 0, 0);
+      return i;
+    }
+    if(pid < 0){
+      static const char msg[] = "cannot fork worker\n";
+      sys(SYS_write, 1, (i64)msg, sizeof(msg) - 1, 0, 0, 0);
+      break;
+    }
+    worker_pids[i] = pid;
+  }
+  return 0;
+}
+
+// Worker 0: collect exited workers so they do not linger as zombies
+static void reap_workers(void){
+  int status;
+  i64 pid;
+  while((pid = sys(SYS_wait4, -1, (i64)&status, WNOHANG, 0, 0, 0)) > 0){
+    static const char msg1[] = "worker ";
+    static const char msg2[] = " exited, status ";
+    char num[12];
+    int i;
+    for(i = 1; i < MAX_WORKERS && worker_pids[i] != pid; i++){}
+    sys(SYS_write, 1, (i64)msg1, sizeof(msg1) - 1, 0, 0, 0);
+    sys(SYS_write, 1, (i64)num, itoa(i, num), 0, 0, 0);
+    sys(SYS_write, 1, (i64)msg2, sizeof(msg2) - 1, 0, 0, 0);
+    sys(SYS_write, 1, (i64)num, itoa(status, num), 0, 0, 0);
+    sys(SYS_write, 1, (i64)"\n", 1, 0, 0, 0);
+    if(i < MAX_WORKERS) worker_pids[i] = 0;
+  }
+}
+
+// ============================================================================
+// Hot region: connection buffers and route payloads in one prefaulted,
+// optionally huge-page backed and mlocked mapping. Set up per worker after
+// pinning, so first-touch also places it on the worker's NUMA node; the
+// pointer updates give the worker its own copy of routes[].
+// ============================================================================
+#define HUGE_PAGE_SIZE (2 << 20)
+
+static const char* const hugepage_names[] = { "4k", "transparent", "hugetlbfs" };
+
+static i64 route_payload_size(void){
+  i64 total = 0;
+  int i;
+  for(i = 0; i < NUM_ROUTES; i++){
+    total += routes[i].response ?
+      routes[i].response_len + routes[i].response_gz_len +
+      routes[i].not_modified_len + routes[i].not_modified_gz_len :
+      routes[i].content_len;
+  }
+  return total;
+}
+
+// Map len prefaulted bytes; *mode drops to what was actually used
+static char* map_hot(i64 len, int* mode){
+  i64 mem;
+  if(*mode == 2){
+    mem = sys(SYS_mmap, 0, len, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if(mem >= 0 || mem <= -4096) return (char*)mem;
+    *mode = 1;  // No hugetlbfs pages reserved
+  }
+  if(*mode == 1){
+    // Over-map by one huge page and trim to a 2 MiB aligned range, then
+    // ask for THP. MAP_POPULATE would fault before the madvise, so touch
+    // each page instead.
+    mem = sys(SYS_mmap, 0, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mem >= 0 || mem <= -4096){
+      i64 start = (mem + HUGE_PAGE_SIZE - 1) & ~(i64)(HUGE_PAGE_SIZE - 1);
+      if(start > mem) sys(SYS_munmap, mem, start - mem, 0, 0, 0, 0);
+      sys(SYS_munmap, start + len, mem + HUGE_PAGE_SIZE - start, 0, 0, 0, 0);
+      if(sys(SYS_madvise, start, len, MADV_HUGEPAGE, 0, 0, 0) < 0) *mode = 0;
+      volatile char* p = (volatile char*)start;
+      i64 off;
+      for(off = 0; off < len; off += 4096) p[off] = 0;
+      return (char*)start;
+    }
+    *mode = 0;  // No room for the alignment slack: plain pages
+  }
+  mem = sys(SYS_mmap, 0, len, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if(mem < 0 && mem > -4096) return 0;
+  return (char*)mem;
+}
+
+static void copy_routes(char* p){
+  int i;
+  for(i = 0; i < NUM_ROUTES; i++){
+    Route* r = &routes[i];
+    if(r->response){
+      // Generated assets: content points into response
+      i64 body_off = r->content - r->response;
+      memcpy_manual(p, r->response, r->response_len);
+      r->response = p;
+      r->content = p + body_off;
+      p += r->response_len;
+      if(r->response_gz){
+        memcpy_manual(p, r->response_gz, r->response_gz_len);
+        r->response_gz = p;
+        p += r->response_gz_len;
+        memcpy_manual(p, r->not_modified_gz, r->not_modified_gz_len);
+        r->not_modified_gz = p;
+        p += r->not_modified_gz_len;
+      }
+      memcpy_manual(p, r->not_modified, r->not_modified_len);
+      r->not_modified = p;
+      p += r->not_modified_len;
+    } else if(r->content){
+      memcpy_manual(p, r->content, r->content_len);
+      r->content = p;
+      p += r->content_len;
+    }
+  }
+}
+
+// ============================================================================
+// Warmup: real requests through handle_request() over a socketpair, so the
+// code, stack and kernel paths of the first client are already mapped
+// ============================================================================
+#define WARM_H2_BATCH 16
+
+// Pump h2 connections the way the main loop does until they have closed
+static void warm_pump_h2(int peer){
+  struct pollfd pfd[H2_MAX_CONNS];
+  char sink[4096];
+  int round;
+  for(round = 0; round < 100 && h2_active; round++){
+    int n = h2_fill_pollfds(pfd);
+#if defined(__x86_64__)
+    sys(SYS_poll, (i64)pfd, n, 10, 0, 0, 0);
+#elif defined(__aarch64__)
+    struct timespec ts = { 0, 10000000 };
+    sys(SYS_ppoll, (i64)pfd, n, (i64)&ts, 0, 0, 0);
+#endif
+    h2_handle_pollfds(pfd, n);
+    while(sys(SYS_read, peer, (i64)sink, sizeof(sink), 0, 0, 0) > 0){}
+  }
+}
+
+// Send req on a fresh socketpair and let handle_request() answer it
+static void warm_exchange(const char* req, int req_len){
+  char sink[4096];
+  int sv[2];
+  if(sys(SYS_socketpair, AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, (i64)sv, 0, 0) < 0) return;
+  sys(SYS_write, sv[0], (i64)req, req_len, 0, 0, 0);
+  handle_request(sv[1]);  // Closes sv[1], or hands it to an h2 slot
+  warm_pump_h2(sv[0]);
+  while(sys(SYS_read, sv[0], (i64)sink, sizeof(sink), 0, 0, 0) > 0){}
+  sys(SYS_close, sv[0], 0, 0, 0, 0, 0);
+}
+
+// Append "<name><value>\r\n"
+static int warm_header(char* buf, const char* name, int name_len, const char* value, int value_len){
+  memcpy_manual(buf, name, name_len);
+  memcpy_manual(buf + name_len, value, value_len);
+  buf[name_len + value_len] = '\r';
+  buf[name_len + value_len + 1] = '\n';
+  return name_len + value_len + 2;
+}
+
+// HTTP/1 GET for every static route (plus the gzip and 304 variants of
+// assets) and a 404, then the same routes over h2 with prior knowledge
+static void warm_routes(void){
+  static const char get[] = "GET ";
+  static const char ver[] = " HTTP/1.1\r\nHost: warmup\r\n";
+  static const char gzip_hdr[] = "Accept-Encoding: ";
+  static const char inm_hdr[] = "If-None-Match: ";
+  static const char missing[] = "/warmup-404";
+  const char* paths[WARM_H2_BATCH];
+  int path_lens[WARM_H2_BATCH];
+  int num_paths = 0;
+  char req[1024];
+  int i, variant;
+
+  for(i = 0; i <= NUM_ROUTES; i++){
+    const char* path = i < NUM_ROUTES ? routes[i].path : missing;
+    int path_len = i < NUM_ROUTES ? routes[i].path_len : (int)sizeof(missing) - 1;
+    if(i < NUM_ROUTES && routes[i].handler) continue;
+    if(path_len > 512) continue;
+
+    for(variant = 0; variant < 3; variant++){
+      int len = 0;
+      if(variant > 0 && (i == NUM_ROUTES || !routes[i].response)) break;
+      memcpy_manual(req, get, sizeof(get) - 1);
+      len += sizeof(get) - 1;
+      memcpy_manual(req + len, path, path_len);
+      len += path_len;
+      memcpy_manual(req + len, ver, sizeof(ver) - 1);
+      len += sizeof(ver) - 1;
+      if(variant == 1) len += warm_header(req + len, gzip_hdr, sizeof(gzip_hdr) - 1, "gzip", 4);
+      if(variant == 2) len += warm_header(req + len, inm_hdr, sizeof(inm_hdr) - 1,
+                                          routes[i].etag, routes[i].etag_len);
+      req[len++] = '\r';
+      req[len++] = '\n';
+      warm_exchange(req, len);
+    }
+
+    paths[num_paths] = path;
+    path_lens[num_paths++] = path_len;
+    if(num_paths == WARM_H2_BATCH || i == NUM_ROUTES){
+      char h2req[WARM_H2_BATCH * 530 + 64];
+      int len = h2_warm_request(h2req, sizeof(h2req), paths, path_lens, num_paths);
+      if(len > 0) warm_exchange(h2req, len);
+      num_paths = 0;
+    }
+  }
+}
+
+static void write_faults(const struct rusage* from, const struct rusage* to){
+  char num[24];
+  sys(SYS_write, 1, (i64)num, u64toa(to->ru_minflt - from->ru_minflt, num), 0, 0, 0);
+  sys(SYS_write, 1, (i64)"/", 1, 0, 0, 0);
+  sys(SYS_write, 1, (i64)num, u64toa(to->ru_majflt - from->ru_majflt, num), 0, 0, 0);
+}
+
+// Build, lock and warm the hot region, then report the minor/major faults
+// each step took
+static void setup_hot_region(int worker){
+  struct rusage before, mapped, warmed, rewarmed;
+  int mode = config.hugepages;
+  if(mode < 0 || mode > 2) mode = 1;
+
+  sys(SYS_getrusage, RUSAGE_SELF, (i64)&before, 0, 0, 0, 0);
+
+  i64 len = sizeof(HotRegion) + route_payload_size();
+  if(mode) len = (len + HUGE_PAGE_SIZE - 1) & ~(i64)(HUGE_PAGE_SIZE - 1);
+  char* mem = map_hot(len, &mode);
+  if(!mem){
+    static const char msg[] = "cannot map hot region\n";
+    sys(SYS_write, 1, (i64)msg, sizeof(msg) - 1, 0, 0, 0);
+    sys(SYS_exit, 1, 0, 0, 0, 0, 0);
+  }
+  hot = (HotRegion*)mem;
+  h2_scratch = hot->h2_scratch;
+  copy_routes(mem + sizeof(HotRegion));
+
+  // Locks (and faults in) text, data, stack and the region
+  const char* lock = "off";
+  if(config.mlock){
+    lock = sys(SYS_mlockall, MCL_CURRENT, 0, 0, 0, 0, 0) == 0 ? "on" : "failed";
+  }
+
+  // Mapped after mlockall and without huge pages, so a slot only takes
+  // memory once a connection uses it (lowest free slot first)
+  i64 pool = sys(SYS_mmap, 0, sizeof(H2Conn) * H2_MAX_CONNS, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(pool < 0 && pool > -4096){
+    static const char msg[] = "cannot map h2 connection pool\n";
+    sys(SYS_write, 1, (i64)msg, sizeof(msg) - 1, 0, 0, 0);
+    sys(SYS_exit, 1, 0, 0, 0, 0, 0);
+  }
+  sys(SYS_madvise, pool, sizeof(H2Conn) * H2_MAX_CONNS, MADV_NOHUGEPAGE, 0, 0, 0);
+  h2_conns = (H2Conn*)pool;
+
+  // The second pass shows what a first client would still pay
+  sys(SYS_getrusage, RUSAGE_SELF, (i64)&mapped, 0, 0, 0, 0);
+  warm_routes();
+  sys(SYS_getrusage, RUSAGE_SELF, (i64)&warmed, 0, 0, 0, 0);
+  warm_routes();
+  sys(SYS_getrusage, RUSAGE_SELF, (i64)&rewarmed, 0, 0, 0, 0);
+#ifdef DIGGY_TRACE
+  trace_head = 0;
+#endif
+#ifdef DIGGY_SYSSTATS
+  sysstats_reset();
+#endif
+
+  static const char m1[] = "worker ";
+  static const char m2[] = " hot region: ";
+  static const char m3[] = " KiB, pages: ";
+  static const char m4[] = ", mlock: ";
+  static const char m5[] = ", faults (minor/major) setup: ";
+  static const char m6[] = ", warmup: ";
+  static const char m7[] = ", after warmup: ";
+  char num[24];
+  sys(SYS_write, 1, (i64)m1, sizeof(m1) - 1, 0, 0, 0);
+  sys(SYS_write, 1, (i64)num, itoa(worker, num), 0, 0, 0);
+  sys(SYS_write, 1, (i64)m2, sizeof(m2) - 1, 0, 0, 0);
+  sys(SYS_write, 1, (i64)num, u64toa(len >> 10, num), 0, 0, 0);
+  sys(SYS_write, 1, (i64)m3, sizeof(m3) - 1, 0, 0, 0);
+  sys(SYS_write, 1, (i64)hugepage_names[mode], str_len(hugepage_names[mode]), 0, 0, 0);
+  sys(SYS_write, 1, (i64)m4, sizeof(m4) - 1, 0, 0, 0);
+  sys(SYS_write, 1, (i64)lock, str_len(lock), 0, 0, 0);
+  sys(SYS_write, 1, (i64)m5, sizeof(m5) - 1, 0, 0, 0);
+  write_faults(&before, &mapped);
+  sys(SYS_write, 1, (i64)m6, sizeof(m6) - 1, 0, 0, 0);
+  write_faults(&mapped, &warmed);
+  sys(SYS_write, 1, (i64)m7, sizeof(m7) - 1, 0, 0, 0);
+  write_faults(&warmed, &rewarmed);
+  sys(SYS_write, 1, (i64)"\n", 1, 0, 0, 0);
+}
+
 // ============================================================================
 // Main server
 // ============================================================================
@@ -563,6 +1370,15 @@ void _start(void){
 
   // Initialize route path lengths
   init_routes();
+  init_lines();
+  h2_init();
+
+#ifdef DIGGY_TRACE
+  trace_init();
+#endif
+#ifdef DIGGY_SYSSTATS
+  sysstats_init();
+#endif
 
   // Print startup message with actual port
   static const char startup_msg1[] = "starting diggy server on :";
@@ -574,55 +1390,157 @@ void _start(void){
   sys(SYS_write, 1, (i64)port_str, port_len, 0, 0, 0);
   sys(SYS_write, 1, (i64)startup_msg2, sizeof(startup_msg2) - 1, 0, 0, 0);
 
-  // Create and configure socket
-  int sock = (int)sys(SYS_socket, AF_INET, SOCK_STREAM, 0, 0, 0, 0);
-  int one = 1;
-  sys(SYS_setsockopt, sock, SOL_SOCKET, SO_REUSEADDR, (i64)&one, sizeof(one), 0);
+  // Every /stream subscriber holds an fd: lift the soft limit to the hard one
+  // and size the subscriber table from whatever limit is in effect
+  struct rlimit rl;
+  if(sys(SYS_prlimit64, 0, RLIMIT_NOFILE, 0, (i64)&rl, 0, 0) == 0){
+    if(rl.rlim_cur < rl.rlim_max){
+      rl.rlim_cur = rl.rlim_max;
+      sys(SYS_prlimit64, 0, RLIMIT_NOFILE, (i64)&rl, 0, 0, 0);
+      sys(SYS_prlimit64, 0, RLIMIT_NOFILE, 0, (i64)&rl, 0, 0);
+    }
+    stream_set_fd_limit(rl.rlim_cur);
+  }
 
-  // Bind and listen using config values
-  struct sockaddr_in addr = {0};
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(config.port);
-  addr.sin_addr.s_addr = config.host;  // Use configured host
+  // Create all listeners up front so socket i is index i of the reuseport
+  // group, which is what the steering program returns
+  int workers = config.workers;
+  if(workers < 1) workers = 1;
+  if(workers > MAX_WORKERS) workers = MAX_WORKERS;
+
+  // Pinning needs a CPU of its own for every worker
+  if(config.cpu_affinity){
+    read_usable_cpus();
+    if(num_usable_cpus < workers){
+      static const char msg1[] = "cpu_affinity: ";
+      static const char msg2[] = " workers but only ";
+      static const char msg3[] = " usable CPUs, not pinning\n";
+      char num[12];
+      sys(SYS_write, 1, (i64)msg1, sizeof(msg1) - 1, 0, 0, 0);
+      sys(SYS_write, 1, (i64)num, itoa(workers, num), 0, 0, 0);
+      sys(SYS_write, 1, (i64)msg2, sizeof(msg2) - 1, 0, 0, 0);
+      sys(SYS_write, 1, (i64)num, itoa(num_usable_cpus, num), 0, 0, 0);
+      sys(SYS_write, 1, (i64)msg3, sizeof(msg3) - 1, 0, 0, 0);
+      config.cpu_affinity = 0;
+    }
+  }
 
-  sys(SYS_bind, sock, (i64)&addr, sizeof(addr), 0, 0, 0);
-  sys(SYS_listen, sock, 128, 0, 0, 0, 0);
+  static int socks[MAX_WORKERS];
+  int i;
+  for(i = 0; i < workers; i++){
+    socks[i] = open_listener(workers > 1);
+  }
+  if(config.cpu_affinity && workers > 1){
+    attach_cpu_steering(socks[0], workers);
+  }
+
+  // Tick base, taken before the fork so every worker agrees on the line
+  u64 start_ns = monotonic_ns();
+
+  int worker = spawn_workers(workers);
+#ifdef DIGGY_TRACE
+  trace_worker = worker;
+#endif
+  int sock = socks[worker];
+  for(i = 0; i < workers; i++){
+    if(i != worker) sys(SYS_close, socks[i], 0, 0, 0, 0, 0);
+  }
+
+  if(config.cpu_affinity){
+    pin_worker(worker, sock);
+  }
+  setup_hot_region(worker);
+
+  // Only one worker feeds stdout
+  if(worker != 0) config.mine = 0;
 
   // Line printing state
-  int current_pos = 0;
-  int elapsed_ms = 0;
+  // Tick n falls n intervals after start_ns and prints line n - 1
+  u64 interval_ns = (u64)(config.interval_ms > 0 ? config.interval_ms : 1) * 1000000ul;
+  u64 next_tick_ns = start_ns + interval_ns;
 
   // Poll structure
-  struct pollfd pfd;
-  pfd.fd = sock;
-  pfd.events = POLLIN;
+  struct pollfd pfd[2 + H2_MAX_CONNS];
+  int nfds = 1;
+  pfd[0].fd = sock;
+  pfd[0].events = POLLIN;
+#ifdef DIGGY_DEBUG_SIGNALS
+  pfd[1].fd = setup_debug_signals();
+  pfd[1].events = POLLIN;
+  if(pfd[1].fd >= 0) nfds = 2;
+#endif
+
+  // Listener pause when accept runs out of fds, see below
+#define ACCEPT_PAUSE_NS 1000000000ul
+  u64 accept_paused_ns = 0;
+  int accept_paused_fds = 0;
 
   // Main server loop
   for(;;){
-    // Poll with configured timeout
+    // Poll with configured timeout, waking up no later than the next tick
+    u64 now_ns = monotonic_ns();
+    int timeout_ms = config.poll_timeout_ms;
+    if(next_tick_ns <= now_ns){
+      timeout_ms = 0;
+    } else if(next_tick_ns - now_ns < (u64)timeout_ms * 1000000ul){
+      timeout_ms = (int)((next_tick_ns - now_ns + 999999) / 1000000);
+    }
     struct timespec ts;
-    ts.tv_sec = config.poll_timeout_ms / 1000;
-    ts.tv_nsec = (config.poll_timeout_ms % 1000) * 1000000;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+
+    // Resume accepting once a subscriber or h2 connection has given back an
+    // fd, or after a second in case one was freed elsewhere
+    if(pfd[0].fd < 0 && (stream_count + h2_active < accept_paused_fds ||
+                         now_ns - accept_paused_ns >= ACCEPT_PAUSE_NS)){
+      pfd[0].fd = sock;
+    }
+
+    // h2 connections follow the fixed entries
+    h2_expire_idle(now_ns);
+    int h2_nfds = h2_fill_pollfds(pfd + nfds);
 
 #if defined(__x86_64__)
-    int ready = (int)sys(SYS_poll, (i64)&pfd, 1, config.poll_timeout_ms, 0, 0, 0);
+    int ready = (int)sys(SYS_poll, (i64)pfd, nfds + h2_nfds, timeout_ms, 0, 0, 0);
 #elif defined(__aarch64__)
-    int ready = (int)sys(SYS_ppoll, (i64)&pfd, 1, (i64)&ts, 0, 0, 0);
+    int ready = (int)sys(SYS_ppoll, (i64)pfd, nfds + h2_nfds, (i64)&ts, 0, 0, 0);
 #endif
 
+    if(ready > 0 && h2_nfds > 0){
+      h2_handle_pollfds(pfd + nfds, h2_nfds);
+    }
+
     // Handle incoming connections
-    if(ready > 0 && (pfd.revents & POLLIN)){
+    if(ready > 0 && (pfd[0].revents & POLLIN)){
+      TRACE_BEGIN(t_accept);
       int client = (int)sys(SYS_accept, sock, 0, 0, 0, 0, 0);
+      TRACE_END(TRACE_ACCEPT, client, t_accept);
       if(client >= 0){
         handle_request(client);
+      } else if(client == -EMFILE || client == -ENFILE){
+        // The pending connection stays queued and the listener stays
+        // readable: stop polling it (poll skips negative fds) so the loop
+        // does not spin until an fd frees up
+        pfd[0].fd = -1;
+        accept_paused_ns = now_ns;
+        accept_paused_fds = stream_count + h2_active;
       }
     }
 
-    // Update timer and print lines
-    elapsed_ms += config.poll_timeout_ms;
-    if(elapsed_ms >= config.interval_ms){
-      elapsed_ms = 0;
-      print_next_line(&current_pos);
+#ifdef DIGGY_DEBUG_SIGNALS
+    if(ready > 0 && nfds > 1 && (pfd[1].revents & POLLIN)){
+      handle_debug_signal(pfd[1].fd);
+    }
+#endif
+
+    // Tick on the clock, not on loop iterations: requests and h2 events
+    // wake the loop early and must not speed up the cadence
+    now_ns = monotonic_ns();
+    if(now_ns >= next_tick_ns){
+      u64 tick = (now_ns - start_ns) / interval_ns;  // Fell behind: skip, do not burst
+      next_tick_ns = start_ns + (tick + 1) * interval_ns;
+      print_line(tick - 1);
+      if(worker == 0 && workers > 1) reap_workers();
     }
   }
 }
\ No newline at end of file
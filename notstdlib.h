@@ -17,6 +17,18 @@ static int itoa(int val, char* buf){
     return i;
 }
 
+static int u64toa(u64 val, char* buf){
+    int i = 0, j;
+    char rev[20];
+    if(val == 0){ buf[0] = '0'; return 1; }
+    while(val > 0){
+        rev[i++] = '0' + (val % 10);
+        val /= 10;
+    }
+    for(j = 0; j < i; j++) buf[j] = rev[i-j-1];
+    return i;
+}
+
 static void* memcpy_manual(char* dst, const char* src, int n){
     int i;
     for(i = 0; i < n; i++) {
@@ -43,3 +55,31 @@ static int compare_strings(const char* s1, const char* s2, int len){
     return 1;
 }
 
+// Monotonic clock in nanoseconds
+static u64 monotonic_ns(void){
+    struct timespec ts;
+    sys(SYS_clock_gettime, CLOCK_MONOTONIC, (i64)&ts, 0, 0, 0, 0);
+    return (u64)ts.tv_sec * 1000000000ul + (u64)ts.tv_nsec;
+}
+
+#if defined(DIGGY_TRACE) || defined(DIGGY_SYSSTATS)
+// ============================================================================
+// Cycle counter calibration: rdcycles() ticks to nanoseconds, measured
+// against the monotonic clock since cycles_calibrate_start()
+// ============================================================================
+static u64 calib_t0_cycles;
+static u64 calib_t0_ns;
+
+static void cycles_calibrate_start(void){
+    if(calib_t0_cycles) return;
+    calib_t0_ns = monotonic_ns();
+    calib_t0_cycles = rdcycles();
+}
+
+static double ns_per_cycle(void){
+    u64 now_cycles = rdcycles();
+    u64 now_ns = monotonic_ns();
+    if(now_cycles <= calib_t0_cycles) return 1.0;
+    return (double)(now_ns - calib_t0_ns) / (double)(now_cycles - calib_t0_cycles);
+}
+#endif
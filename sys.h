@@ -1,6 +1,7 @@
 #pragma once
 
 typedef long i64;
+typedef unsigned long u64;
 typedef unsigned short u16;
 typedef unsigned int u32;
 
@@ -8,7 +9,7 @@ typedef unsigned int u32;
 // System call definitions (unchanged)
 // ============================================================================
 #if defined(__x86_64__)
-static inline i64 sys(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
+static inline i64 sys_raw(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
   register i64 r10 __asm__("r10") = d;
   register i64 r8  __asm__("r8")  = e;
   register i64 r9  __asm__("r9")  = f;
@@ -29,8 +30,27 @@ static inline i64 sys(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
 #  define SYS_accept 43
 #  define SYS_setsockopt 54
 #  define SYS_exit 60
+#  define SYS_rt_sigprocmask 14
+#  define SYS_clock_gettime 228
+#  define SYS_signalfd4 289
+#  define SYS_sendto 44
+#  define SYS_recvfrom 45
+#  define SYS_prlimit64 302
+#  define SYS_mmap 9
+#  define SYS_clone 56
+#  define SYS_prctl 157
+#  define SYS_sched_setaffinity 203
+#  define SYS_sched_getaffinity 204
+#  define SYS_munmap 11
+#  define SYS_madvise 28
+#  define SYS_mlockall 151
+#  define SYS_getrusage 98
+#  define SYS_socketpair 53
+#  define SYS_getpid 39
+#  define SYS_getppid 110
+#  define SYS_wait4 61
 #elif defined(__aarch64__)
-static inline i64 sys(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
+static inline i64 sys_raw(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
   register i64 x8 __asm__("x8") = n;
   register i64 x0 __asm__("x0") = a;
   register i64 x1 __asm__("x1") = b;
@@ -53,15 +73,112 @@ static inline i64 sys(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
 #  define SYS_accept 202
 #  define SYS_setsockopt 208
 #  define SYS_exit 93
+#  define SYS_rt_sigprocmask 135
+#  define SYS_clock_gettime 113
+#  define SYS_signalfd4 74
+#  define SYS_sendto 206
+#  define SYS_recvfrom 207
+#  define SYS_prlimit64 261
+#  define SYS_mmap 222
+#  define SYS_clone 220
+#  define SYS_prctl 167
+#  define SYS_sched_setaffinity 122
+#  define SYS_sched_getaffinity 123
+#  define SYS_munmap 215
+#  define SYS_madvise 233
+#  define SYS_mlockall 230
+#  define SYS_getrusage 165
+#  define SYS_socketpair 199
+#  define SYS_getpid 172
+#  define SYS_getppid 173
+#  define SYS_wait4 260
 #else
 #  error "Unsupported arch"
 #endif
 
+#define AF_UNIX 1
 #define AF_INET 2
 #define SOCK_STREAM 1
+#define SOCK_NONBLOCK 04000
 #define SOL_SOCKET 1
 #define SO_REUSEADDR 2
+#define SO_SNDBUF 7
+#define SO_REUSEPORT 15
+#define SO_INCOMING_CPU 49
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#define IPPROTO_TCP 6
+#define TCP_NODELAY 1
+#define MSG_DONTWAIT 0x40
+#define MSG_NOSIGNAL 0x4000
+#define RLIMIT_NOFILE 7
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define MAP_PRIVATE 0x02
+#define MAP_ANONYMOUS 0x20
+#define MAP_POPULATE 0x8000
+#define MAP_HUGETLB 0x40000
+#define MADV_HUGEPAGE 14
+#define MADV_NOHUGEPAGE 15
+#define MCL_CURRENT 1
+#define RUSAGE_SELF 0
+#define SIGCHLD 17
+#define PR_SET_PDEATHSIG 1
+#define WNOHANG 1
 #define POLLIN 0x001
+#define POLLOUT 0x004
+#define EAGAIN 11
+#define ENFILE 23
+#define EMFILE 24
+#define CLOCK_MONOTONIC 1
+#define SIG_BLOCK 0
+#define SIGINT 2
+#define SIGUSR1 10
+#define SIGUSR2 12
+#define SIGTERM 15
+
+// ============================================================================
+// Cycle counter (TSC on x86_64, virtual counter on aarch64)
+// ============================================================================
+static inline u64 rdcycles(void){
+#if defined(__x86_64__)
+  u32 lo, hi;
+  __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((u64)hi << 32) | lo;
+#elif defined(__aarch64__)
+  u64 v;
+  __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+  return v;
+#endif
+}
+
+// ============================================================================
+// sys(): every syscall goes through here
+// Build with -DDIGGY_SYSSTATS to count calls, errors and cycles per syscall
+// number; otherwise it is sys_raw() and compiles away.
+// ============================================================================
+#ifdef DIGGY_SYSSTATS
+#define SYSSTATS_MAX_NR 512
+
+static u64 sysstats_calls[SYSSTATS_MAX_NR];
+static u64 sysstats_errors[SYSSTATS_MAX_NR];
+static u64 sysstats_cycles[SYSSTATS_MAX_NR];
+
+static inline i64 sys(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
+  u64 t0 = rdcycles();
+  i64 r = sys_raw(n, a, b, c, d, e, f);
+  u64 dt = rdcycles() - t0;
+  if((u64)n < SYSSTATS_MAX_NR){
+    sysstats_calls[n]++;
+    sysstats_cycles[n] += dt;
+    if(r < 0 && r > -4096) sysstats_errors[n]++;
+  }
+  return r;
+}
+#else
+static inline __attribute__((always_inline)) i64 sys(i64 n,i64 a,i64 b,i64 c,i64 d,i64 e,i64 f){
+  return sys_raw(n, a, b, c, d, e, f);
+}
+#endif
 
 // ============================================================================
 // Network structures
@@ -77,6 +194,46 @@ struct timespec {
   i64 tv_nsec;
 };
 
+// Only the fields we read; the kernel always writes the full 128 bytes
+struct signalfd_siginfo {
+  u32 ssi_signo;
+  unsigned char pad[124];
+};
+
+// Only the fault counters are read
+struct rusage {
+  i64 ru_utime[2];
+  i64 ru_stime[2];
+  i64 ru_maxrss, ru_ixrss, ru_idrss, ru_isrss;
+  i64 ru_minflt, ru_majflt;
+  i64 pad[8];
+};
+
+struct rlimit {
+  u64 rlim_cur;
+  u64 rlim_max;
+};
+
+// Classic BPF (SO_ATTACH_REUSEPORT_CBPF)
+struct sock_filter {
+  u16 code;
+  unsigned char jt;
+  unsigned char jf;
+  u32 k;
+};
+
+struct sock_fprog {
+  u16 len;
+  const struct sock_filter* filter;
+};
+
+#define BPF_LD_W_ABS 0x20   // BPF_LD | BPF_W | BPF_ABS
+#define BPF_ALU_MOD_K 0x94  // BPF_ALU | BPF_MOD | BPF_K
+#define BPF_RET_A 0x16      // BPF_RET | BPF_A
+#define BPF_RET_K 0x06      // BPF_RET | BPF_K
+#define BPF_JEQ_K 0x15      // BPF_JMP | BPF_JEQ | BPF_K
+#define SKF_AD_CPU (-0x1000 + 36)  // SKF_AD_OFF + SKF_AD_CPU
+
 struct in_addr{ u32 s_addr; };
 struct sockaddr_in{
   u16 sin_family; u16 sin_port; struct in_addr sin_addr; unsigned char sin_zero[8];
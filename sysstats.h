@@ -0,0 +1,131 @@
+#pragma once
+
+// ============================================================================
+// Syscall accounting report (build with -DDIGGY_SYSSTATS)
+// The counters live in sys.h's sys(); this turns them into calls/request and
+// time/syscall per syscall number.
+// ============================================================================
+#ifdef DIGGY_SYSSTATS
+
+static u64 sysstats_requests;
+
+#define SYSSTATS_REQUEST()  (sysstats_requests++)
+
+static const struct { int nr; const char* name; } sysstats_names[] = {
+  {SYS_read, "read"}, {SYS_write, "write"}, {SYS_close, "close"},
+#if defined(__x86_64__)
+  {SYS_open, "open"}, {SYS_poll, "poll"},
+#elif defined(__aarch64__)
+  {SYS_openat, "openat"}, {SYS_ppoll, "ppoll"},
+#endif
+  {SYS_socket, "socket"}, {SYS_bind, "bind"}, {SYS_listen, "listen"},
+  {SYS_accept, "accept"}, {SYS_setsockopt, "setsockopt"}, {SYS_exit, "exit"},
+  {SYS_rt_sigprocmask, "rt_sigprocmask"}, {SYS_clock_gettime, "clock_gettime"},
+  {SYS_signalfd4, "signalfd4"}, {SYS_sendto, "sendto"}, {SYS_recvfrom, "recvfrom"}, {SYS_prlimit64, "prlimit64"},
+  {SYS_mmap, "mmap"}, {SYS_clone, "clone"}, {SYS_prctl, "prctl"},
+  {SYS_sched_setaffinity, "sched_setaffinity"}, {SYS_sched_getaffinity, "sched_getaffinity"}, {SYS_munmap, "munmap"},
+  {SYS_madvise, "madvise"}, {SYS_mlockall, "mlockall"}, {SYS_getrusage, "getrusage"},
+  {SYS_socketpair, "socketpair"}, {SYS_getpid, "getpid"}, {SYS_getppid, "getppid"}, {SYS_wait4, "wait4"},
+};
+
+static void sysstats_init(void){
+  cycles_calibrate_start();
+}
+
+// Forget startup and warmup traffic
+static void sysstats_reset(void){
+  int nr;
+  for(nr = 0; nr < SYSSTATS_MAX_NR; nr++){
+    sysstats_calls[nr] = sysstats_errors[nr] = sysstats_cycles[nr] = 0;
+  }
+  sysstats_requests = 0;
+}
+
+// Append s left-aligned in width columns
+static int sysstats_col(char* buf, const char* s, int len, int width){
+  int n = 0;
+  memcpy_manual(buf, s, len);
+  n += len;
+  while(n < width) buf[n++] = ' ';
+  return n;
+}
+
+// Append a hundredths value as "12.34" right-aligned in width columns
+static int sysstats_fixed2(char* buf, u64 hundredths, int width){
+  char num[24];
+  int len = u64toa(hundredths / 100, num);
+  int n = 0;
+  num[len++] = '.';
+  num[len++] = '0' + (hundredths / 10) % 10;
+  num[len++] = '0' + hundredths % 10;
+  while(n + len < width) buf[n++] = ' ';
+  memcpy_manual(buf + n, num, len);
+  return n + len;
+}
+
+static int sysstats_u64(char* buf, u64 v, int width){
+  char num[24];
+  int len = u64toa(v, num);
+  int n = 0;
+  while(n + len < width) buf[n++] = ' ';
+  memcpy_manual(buf + n, num, len);
+  return n + len;
+}
+
+// Write the per-syscall table to fd
+static void sysstats_report(int fd){
+  static const char hdr[] = "syscall               calls   errors  per_req    avg_ns    total_us\n";
+  static const char req_label[] = "requests: ";
+  char out[4096];
+  int pos = 0;
+  double ns_per_cyc = ns_per_cycle();
+  u64 reqs = sysstats_requests;
+  int nr;
+
+  memcpy_manual(out, req_label, sizeof(req_label) - 1);
+  pos += sizeof(req_label) - 1;
+  pos += u64toa(reqs, out + pos);
+  out[pos++] = '\n';
+  memcpy_manual(out + pos, hdr, sizeof(hdr) - 1);
+  pos += sizeof(hdr) - 1;
+
+  for(nr = 0; nr < SYSSTATS_MAX_NR; nr++){
+    u64 calls = sysstats_calls[nr];
+    if(calls == 0) continue;
+
+    // Each row is under 100 bytes
+    if(pos > (int)sizeof(out) - 100){
+      sys(SYS_write, fd, (i64)out, pos, 0, 0, 0);
+      pos = 0;
+    }
+
+    const char* name = 0;
+    int k;
+    for(k = 0; k < (int)(sizeof(sysstats_names) / sizeof(sysstats_names[0])); k++){
+      if(sysstats_names[k].nr == nr){ name = sysstats_names[k].name; break; }
+    }
+    if(name){
+      pos += sysstats_col(out + pos, name, str_len(name), 18);
+    } else {
+      char num[12];
+      int len = itoa(nr, num + 3);
+      num[0] = 'n'; num[1] = 'r'; num[2] = ' ';
+      pos += sysstats_col(out + pos, num, len + 3, 18);
+    }
+
+    u64 total_ns = (u64)((double)sysstats_cycles[nr] * ns_per_cyc);
+    pos += sysstats_u64(out + pos, calls, 9);
+    pos += sysstats_u64(out + pos, sysstats_errors[nr], 9);
+    pos += sysstats_fixed2(out + pos, reqs ? calls * 100 / reqs : 0, 9);
+    pos += sysstats_u64(out + pos, total_ns / calls, 10);
+    pos += sysstats_u64(out + pos, total_ns / 1000, 12);
+    out[pos++] = '\n';
+  }
+  sys(SYS_write, fd, (i64)out, pos, 0, 0, 0);
+}
+
+#else
+
+#define SYSSTATS_REQUEST()  ((void)0)
+
+#endif
@@ -0,0 +1,289 @@
+// ============================================================================
+// assetc: build-time asset compiler (runs on the build host, uses libc + zlib)
+//
+//   cc -O2 -o assetc tools/assetc.c -lz
+//   ./assetc assets assets.h
+//
+// Every file under the asset directory becomes a route at its relative path
+// (assets/robots.txt -> /robots.txt). For each asset the generated header
+// holds the fully rendered HTTP responses (identity, gzip when smaller, and
+// a 304 Not Modified for each), the body length, MIME type and ETags, plus an
+// ASSET_ROUTES macro that main.c splices into its route table. Nothing is
+// computed at startup or per request.
+// ============================================================================
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define MAX_ASSETS 256
+
+typedef struct {
+  char path[512];      // URL path, e.g. "/robots.txt"
+  char file[1024];     // Source file
+  const char* mime;
+  unsigned char* body;
+  size_t body_len;
+  unsigned char* gz;
+  size_t gz_len;       // 0 when gzip does not pay off
+  char etag[19];       // "<16 hex digits>", quotes included
+  char etag_gz[22];    // "<16 hex digits>-gz": a different coding needs its own strong ETag
+} Asset;
+
+static Asset assets[MAX_ASSETS];
+static int num_assets;
+
+static const struct { const char* ext; const char* mime; } mime_types[] = {
+  {".txt",  "text/plain; charset=utf-8"},
+  {".html", "text/html; charset=utf-8"},
+  {".htm",  "text/html; charset=utf-8"},
+  {".css",  "text/css; charset=utf-8"},
+  {".js",   "text/javascript; charset=utf-8"},
+  {".json", "application/json"},
+  {".xml",  "application/xml"},
+  {".svg",  "image/svg+xml"},
+  {".png",  "image/png"},
+  {".jpg",  "image/jpeg"},
+  {".jpeg", "image/jpeg"},
+  {".gif",  "image/gif"},
+  {".ico",  "image/x-icon"},
+  {".webp", "image/webp"},
+  {".woff2", "font/woff2"},
+  {".wasm", "application/wasm"},
+};
+
+static const char* mime_for(const char* name){
+  const char* dot = strrchr(name, '.');
+  size_t i;
+  if(dot){
+    for(i = 0; i < sizeof(mime_types) / sizeof(mime_types[0]); i++){
+      if(strcmp(dot, mime_types[i].ext) == 0) return mime_types[i].mime;
+    }
+  }
+  return "application/octet-stream";
+}
+
+// Already-compressed formats are not worth a gzip variant
+static int compressible(const char* mime){
+  return strncmp(mime, "text/", 5) == 0 || strstr(mime, "json") ||
+         strstr(mime, "xml") || strstr(mime, "javascript") || strstr(mime, "wasm");
+}
+
+static void die(const char* what, const char* arg){
+  fprintf(stderr, "assetc: %s: %s\n", what, arg);
+  exit(1);
+}
+
+static unsigned char* read_file(const char* file, size_t* len){
+  FILE* f = fopen(file, "rb");
+  if(!f) die("cannot open", file);
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  unsigned char* buf = malloc(n > 0 ? n : 1);
+  if(!buf || fread(buf, 1, n, f) != (size_t)n) die("cannot read", file);
+  fclose(f);
+  *len = n;
+  return buf;
+}
+
+static void gzip_body(Asset* a){
+  z_stream zs;
+  uLong bound;
+  memset(&zs, 0, sizeof(zs));
+  if(deflateInit2(&zs, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) die("deflateInit2", a->file);
+  bound = deflateBound(&zs, a->body_len);
+  a->gz = malloc(bound);
+  zs.next_in = a->body;
+  zs.avail_in = a->body_len;
+  zs.next_out = a->gz;
+  zs.avail_out = bound;
+  if(deflate(&zs, Z_FINISH) != Z_STREAM_END) die("deflate", a->file);
+  a->gz_len = zs.total_out;
+  deflateEnd(&zs);
+  if(a->gz_len >= a->body_len) a->gz_len = 0;
+}
+
+// FNV-1a 64-bit over the body
+static void make_etag(Asset* a){
+  unsigned long long h = 0xcbf29ce484222325ull;
+  size_t i;
+  for(i = 0; i < a->body_len; i++){
+    h ^= a->body[i];
+    h *= 0x100000001b3ull;
+  }
+  snprintf(a->etag, sizeof(a->etag), "\"%016llx\"", h);
+  snprintf(a->etag_gz, sizeof(a->etag_gz), "\"%016llx-gz\"", h);
+}
+
+// Built-in routes in main.c; keep in sync with its route table. An asset at
+// one of these paths would shadow it or be shadowed, depending on order
+static const char* const builtin_routes[] = {
+  "/", "/health", "/about", "/info", "/stream", "/debug/trace", "/debug/syscalls",
+};
+
+static void scan_dir(const char* dir, const char* prefix){
+  DIR* d = opendir(dir);
+  struct dirent* e;
+  if(!d) die("cannot open directory", dir);
+  while((e = readdir(d))){
+    char file[1024], path[512];
+    struct stat st;
+    if(e->d_name[0] == '.') continue;
+    snprintf(file, sizeof(file), "%s/%s", dir, e->d_name);
+    snprintf(path, sizeof(path), "%s/%s", prefix, e->d_name);
+    if(stat(file, &st) != 0) die("cannot stat", file);
+    if(S_ISDIR(st.st_mode)){
+      scan_dir(file, path);
+    } else if(S_ISREG(st.st_mode)){
+      size_t j;
+      for(j = 0; j < sizeof(builtin_routes) / sizeof(builtin_routes[0]); j++){
+        if(strcmp(path, builtin_routes[j]) == 0) die("asset duplicates built-in route", file);
+      }
+      if(num_assets == MAX_ASSETS) die("too many assets in", dir);
+      Asset* a = &assets[num_assets++];
+      snprintf(a->path, sizeof(a->path), "%s", path);
+      snprintf(a->file, sizeof(a->file), "%s", file);
+    }
+  }
+  closedir(d);
+}
+
+static int by_path(const void* x, const void* y){
+  return strcmp(((const Asset*)x)->path, ((const Asset*)y)->path);
+}
+
+// Emit s as the body of a C string literal; paths come from file names
+static void emit_c_string(FILE* out, const char* s){
+  for(; *s; s++){
+    unsigned char c = (unsigned char)*s;
+    if(c == '"' || c == '\\') fprintf(out, "\\%c", c);
+    else if(c < 0x20 || c >= 0x7f) fprintf(out, "\\%03o", c);
+    else fputc(c, out);
+  }
+}
+
+// Emit a C array initializer, 16 bytes per line
+static void emit_bytes(FILE* out, const unsigned char* p, size_t n){
+  size_t i;
+  for(i = 0; i < n; i++){
+    fprintf(out, "%s0x%02x,", i % 16 == 0 ? "\n  " : "", p[i]);
+  }
+}
+
+static size_t emit_header_and_body(FILE* out, const char* hdr, const unsigned char* body, size_t body_len){
+  size_t hdr_len = strlen(hdr);
+  emit_bytes(out, (const unsigned char*)hdr, hdr_len);
+  emit_bytes(out, body, body_len);
+  return hdr_len + body_len;
+}
+
+int main(int argc, char** argv){
+  char hdr[1024];
+  FILE* out;
+  int i;
+  size_t total = 0;
+
+  if(argc != 3){
+    fprintf(stderr, "usage: assetc <asset-dir> <output.h>\n");
+    return 2;
+  }
+  scan_dir(argv[1], "");
+  qsort(assets, num_assets, sizeof(Asset), by_path);
+
+  out = fopen(argv[2], "w");
+  if(!out) die("cannot write", argv[2]);
+  fprintf(out, "#pragma once\n// Generated by tools/assetc.c from %s/ -- do not edit\n", argv[1]);
+
+  printf("%-32s %-28s %10s %10s %10s\n", "route", "type", "body", "gzip", "in binary");
+  for(i = 0; i < num_assets; i++){
+    Asset* a = &assets[i];
+    size_t hdr_len, resp_len, gz_resp_len = 0, nm_len;
+    const char* vary;
+
+    a->mime = mime_for(a->path);
+    a->body = read_file(a->file, &a->body_len);
+    if(compressible(a->mime)) gzip_body(a);
+    make_etag(a);
+    vary = a->gz_len ? "Vary: Accept-Encoding\r\n" : "";
+
+    // Each response starts on its own cache line; headers and body are
+    // contiguous so a request is served with a single write
+    fprintf(out, "\n// \"");
+    emit_c_string(out, a->path);
+    fprintf(out, "\"\n");
+    snprintf(hdr, sizeof(hdr),
+             "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: close\r\n"
+             "Content-Type: %s\r\nETag: %s\r\n%s\r\n",
+             a->body_len, a->mime, a->etag, vary);
+    hdr_len = strlen(hdr);
+    fprintf(out, "static const char asset_%d_response[] __attribute__((aligned(64))) = {", i);
+    resp_len = emit_header_and_body(out, hdr, a->body, a->body_len);
+    fprintf(out, "\n};\n");
+    fprintf(out, "#define ASSET_%d_BODY (asset_%d_response + %zu)\n", i, i, hdr_len);
+    fprintf(out, "#define ASSET_%d_BODY_LEN %zu\n", i, a->body_len);
+
+    if(a->gz_len){
+      snprintf(hdr, sizeof(hdr),
+               "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: close\r\n"
+               "Content-Type: %s\r\nContent-Encoding: gzip\r\nETag: %s\r\n%s\r\n",
+               a->gz_len, a->mime, a->etag_gz, vary);
+      fprintf(out, "static const char asset_%d_response_gz[] __attribute__((aligned(64))) = {", i);
+      gz_resp_len = emit_header_and_body(out, hdr, a->gz, a->gz_len);
+      fprintf(out, "\n};\n");
+    }
+
+    snprintf(hdr, sizeof(hdr),
+             "HTTP/1.1 304 Not Modified\r\nConnection: close\r\nETag: %s\r\n%s\r\n",
+             a->etag, vary);
+    nm_len = strlen(hdr);
+    fprintf(out, "static const char asset_%d_not_modified[] = {", i);
+    emit_bytes(out, (const unsigned char*)hdr, nm_len);
+    fprintf(out, "\n};\n");
+
+    if(a->gz_len){
+      snprintf(hdr, sizeof(hdr),
+               "HTTP/1.1 304 Not Modified\r\nConnection: close\r\nETag: %s\r\n%s\r\n",
+               a->etag_gz, vary);
+      nm_len += strlen(hdr);
+      fprintf(out, "static const char asset_%d_not_modified_gz[] = {", i);
+      emit_bytes(out, (const unsigned char*)hdr, strlen(hdr));
+      fprintf(out, "\n};\n");
+    }
+
+    size_t in_binary = resp_len + gz_resp_len + nm_len + strlen(a->path) + 1 + strlen(a->etag) + 1 +
+                       (a->gz_len ? strlen(a->etag_gz) + 1 : 0);
+    total += in_binary;
+    printf("%-32s %-28s %10zu %10zu %10zu\n", a->path, a->mime, a->body_len, a->gz_len, in_binary);
+  }
+
+  // Route entries; lengths are precomputed so init_routes leaves them alone
+  fprintf(out, "\n#define ASSET_ROUTES");
+  for(i = 0; i < num_assets; i++){
+    Asset* a = &assets[i];
+    fprintf(out, " \\\n  {\"");
+    emit_c_string(out, a->path);
+    fprintf(out, "\", ASSET_%d_BODY, \"%s\", .path_len = %zu, .content_type_len = %zu,"
+                 " .content_len = ASSET_%d_BODY_LEN,"
+                 " .response = asset_%d_response, .response_len = sizeof(asset_%d_response),",
+            i, a->mime, strlen(a->path), strlen(a->mime), i, i, i);
+    if(a->gz_len){
+      fprintf(out, " .response_gz = asset_%d_response_gz, .response_gz_len = sizeof(asset_%d_response_gz),"
+                   " .etag_gz = \"\\\"%.16s-gz\\\"\", .etag_gz_len = %zu,"
+                   " .not_modified_gz = asset_%d_not_modified_gz,"
+                   " .not_modified_gz_len = sizeof(asset_%d_not_modified_gz),",
+              i, i, a->etag_gz + 1, strlen(a->etag_gz), i, i);
+    }
+    // The ETag's own quotes are escaped: "\"<hex>\""
+    fprintf(out, " .etag = \"\\\"%.16s\\\"\", .etag_len = %zu,"
+                 " .not_modified = asset_%d_not_modified, .not_modified_len = sizeof(asset_%d_not_modified)},",
+            a->etag + 1, strlen(a->etag), i, i);
+  }
+  fprintf(out, "\n");
+
+  printf("%d asset(s), %zu bytes in binary\n", num_assets, total);
+  if(fclose(out) != 0) die("cannot write", argv[2]);
+  return 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+// ============================================================================
+// Span tracer (build with -DDIGGY_TRACE)
+// Records (phase, fd, start, duration) in cycles into a ring buffer and dumps
+// it as Chrome trace-event JSON (load in chrome://tracing or Perfetto).
+// Without DIGGY_TRACE the macros below expand to nothing.
+// ============================================================================
+enum {
+  TRACE_ACCEPT,
+  TRACE_READ,
+  TRACE_PARSE,
+  TRACE_ROUTE,
+  TRACE_BUILD,
+  TRACE_WRITE,
+  TRACE_CLOSE,
+};
+
+#ifdef DIGGY_TRACE
+
+#define TRACE_RING_SIZE 4096  // Must be a power of two
+
+typedef struct {
+  u64 start;
+  u64 duration;  // Full width: a u32 wraps after ~1.4s at 3GHz
+  u32 phase;
+  int fd;
+} Span;
+
+// One ring per worker process. The only writer and the dumper run on the
+// same thread, so a free-running head index is all the ring needs.
+static Span trace_ring[TRACE_RING_SIZE];
+static u32 trace_head;
+static int trace_worker;  // Emitted as the trace-event pid
+
+static const char* const trace_phase_names[] = {
+  "accept", "read", "parse", "route", "build", "write", "close",
+};
+
+#define TRACE_BEGIN(t)           u64 t = rdcycles()
+#define TRACE_END(phase, fd, t)  trace_span((phase), (fd), (t))
+
+static void trace_init(void){
+  cycles_calibrate_start();
+}
+
+static inline void trace_span(u32 phase, int fd, u64 start){
+  Span* s = &trace_ring[trace_head++ & (TRACE_RING_SIZE - 1)];
+  s->start = start;
+  s->duration = rdcycles() - start;
+  s->phase = phase;
+  s->fd = fd;
+}
+
+// Append "<ns/1000>.<ns%1000>" (microseconds, as trace-event JSON expects)
+static int trace_fmt_us(char* buf, u64 ns){
+  int n = u64toa(ns / 1000, buf);
+  u32 frac = (u32)(ns % 1000);
+  buf[n++] = '.';
+  buf[n++] = '0' + frac / 100;
+  buf[n++] = '0' + frac / 10 % 10;
+  buf[n++] = '0' + frac % 10;
+  return n;
+}
+
+// Write the ring, oldest span first, to fd
+static void trace_dump(int fd){
+  static const char head[] = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  static const char tail[] = "]}\n";
+  static const char e1[] = "{\"name\":\"";
+  static const char e2[] = "\",\"ph\":\"X\",\"pid\":";
+  static const char e2b[] = ",\"tid\":1,\"ts\":";
+  static const char e3[] = ",\"dur\":";
+  static const char e4[] = ",\"args\":{\"fd\":";
+  static const char e5[] = "}}";
+  char out[4096];
+  int pos = 0;
+
+  double ns_per_cyc = ns_per_cycle();
+
+  u32 count = trace_head < TRACE_RING_SIZE ? trace_head : TRACE_RING_SIZE;
+  u32 first = trace_head - count;
+  u32 i;
+
+  sys(SYS_write, fd, (i64)head, sizeof(head) - 1, 0, 0, 0);
+  for(i = 0; i < count; i++){
+    const Span* s = &trace_ring[(first + i) & (TRACE_RING_SIZE - 1)];
+    const char* name = trace_phase_names[s->phase];
+
+    // Worst case for one event is well under 200 bytes
+    if(pos > (int)sizeof(out) - 200){
+      sys(SYS_write, fd, (i64)out, pos, 0, 0, 0);
+      pos = 0;
+    }
+
+    if(i > 0) out[pos++] = ',';
+    memcpy_manual(out + pos, e1, sizeof(e1) - 1);
+    pos += sizeof(e1) - 1;
+    memcpy_manual(out + pos, name, str_len(name));
+    pos += str_len(name);
+    memcpy_manual(out + pos, e2, sizeof(e2) - 1);
+    pos += sizeof(e2) - 1;
+    pos += itoa(trace_worker, out + pos);
+    memcpy_manual(out + pos, e2b, sizeof(e2b) - 1);
+    pos += sizeof(e2b) - 1;
+    pos += trace_fmt_us(out + pos, (u64)((double)(s->start - calib_t0_cycles) * ns_per_cyc));
+    memcpy_manual(out + pos, e3, sizeof(e3) - 1);
+    pos += sizeof(e3) - 1;
+    pos += trace_fmt_us(out + pos, (u64)((double)s->duration * ns_per_cyc));
+    memcpy_manual(out + pos, e4, sizeof(e4) - 1);
+    pos += sizeof(e4) - 1;
+    if(s->fd < 0){
+      out[pos++] = '-';
+      pos += itoa(-s->fd, out + pos);
+    } else {
+      pos += itoa(s->fd, out + pos);
+    }
+    memcpy_manual(out + pos, e5, sizeof(e5) - 1);
+    pos += sizeof(e5) - 1;
+  }
+  if(pos > 0) sys(SYS_write, fd, (i64)out, pos, 0, 0, 0);
+  sys(SYS_write, fd, (i64)tail, sizeof(tail) - 1, 0, 0, 0);
+}
+
+#else
+
+#define TRACE_BEGIN(t)           ((void)0)
+#define TRACE_END(phase, fd, t)  ((void)0)
+
+#endif